@@ -0,0 +1,48 @@
+/**
+ * Helpers shared by the offline benchmarks.
+ */
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#else
+#define BENCH_HAVE_TSC 0
+#endif
+
+/**
+   Time stamp counter, or 0 where there is none.@n
+   The TSC ticks at a constant reference rate, which is not necessarily the current core clock.
+ */
+static inline uint64_t readCycles()
+{
+#if BENCH_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+   Small xorshift generator for reproducible white noise between -0.5 and 0.5.
+ */
+struct NoiseSource {
+    uint32_t seed;
+
+    explicit NoiseSource(uint32_t s)
+        : seed(s != 0 ? s : 1) { }
+
+    float next()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return (float)((int32_t)seed * (0.5 / 2147483648.0));
+    }
+};
+
+#endif  // #ifndef BENCH_COMMON_H
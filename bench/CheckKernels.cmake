@@ -0,0 +1,48 @@
+# Check that the specialized filter kernels in a built binary call their sst unit directly.
+#
+# FilterKernels.hpp relies on GetQFPtrFilterUnit being constant-folded once the type and subtype are template
+# arguments, and on the flatten attribute inlining the unit it returns. Neither is promised by the language, so this
+# reads the disassembly and fails if any filterBlockKernel<FT, FST> still contains an indirect call or jump.
+#
+# Usage: cmake -DOBJDUMP=<objdump> -DBINARY=<file> -P CheckKernels.cmake
+
+if(NOT OBJDUMP OR NOT BINARY)
+  message(FATAL_ERROR "usage: cmake -DOBJDUMP=<objdump> -DBINARY=<file> -P CheckKernels.cmake")
+endif()
+
+execute_process(COMMAND ${OBJDUMP} -d -C --no-show-raw-insn ${BINARY}
+                OUTPUT_VARIABLE disassembly
+                RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "${OBJDUMP} failed on ${BINARY}")
+endif()
+
+# one list entry per function, objdump separates them with an empty line
+string(REPLACE ";" "," disassembly "${disassembly}")
+string(REPLACE "[" "(" disassembly "${disassembly}")
+string(REPLACE "]" ")" disassembly "${disassembly}")
+string(REPLACE "\n\n" ";" functions "${disassembly}")
+
+set(kernels 0)
+set(failed "")
+foreach(function IN LISTS functions)
+  if(function MATCHES "^[0-9a-f]+ <void filterBlockKernel<([0-9]+), ([0-9]+)>")
+    set(kernel "${CMAKE_MATCH_1}/${CMAKE_MATCH_2}")
+    math(EXPR kernels "${kernels} + 1")
+    # x86 call/jmp through a register or memory, aarch64 blr/br
+    if(function MATCHES "\t(call|jmp)[a-z]*[ ]+\\*" OR function MATCHES "\t(blr|br)[ ]+[xw]")
+      list(APPEND failed "${kernel}")
+    endif()
+  endif()
+endforeach()
+
+if(kernels EQUAL 0)
+  message(FATAL_ERROR "no filterBlockKernel symbols in ${BINARY}, is it stripped?")
+endif()
+
+if(failed)
+  string(REPLACE ";" ", " failed "${failed}")
+  message(FATAL_ERROR "kernels still calling through a pointer (type/subtype): ${failed}")
+endif()
+
+message(STATUS "${kernels} specialized filter kernels, none calling through a pointer")
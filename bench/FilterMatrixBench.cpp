@@ -0,0 +1,286 @@
+/**
+ * Cost of every sst filter type and subtype.
+ *
+ * Each (FilterType, FilterSubType) pair gets one quad filter state, set up the same way the plugin sets up its own,
+ * and is measured twice: the per-sample cost of running the filter with fixed coefficients, and the per-call cost
+ * of FilterCoefficientMaker::MakeCoeffs, which the plugin pays once per control sub-block while a parameter moves.
+ * The filter is timed through its specialized block kernel and again through the generic one calling the unit
+ * pointer, so a kernel that did not get devirtualized shows up as a speedup close to 1.
+ * Results are written as JSON, with each filter cost also given relative to the cheapest type.
+ *
+ * Usage: imgui-demo-plugin-filter-matrix [--rate Hz] [--block frames] [--seconds s] [--type n] [--output file]
+ */
+
+#include "BenchCommon.hpp"
+#include "FilterKernels.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------------------------------------------------
+
+struct Options {
+    double sampleRate = 48000.0;
+    uint32_t blockSize = 64;
+    double seconds = 0.1;
+    int type = -1;
+    const char* output = nullptr;
+};
+
+struct Result {
+    int type;
+    int subType;
+    double filterNsPerSample;
+    double filterCyclesPerSample;
+    double genericNsPerSample;
+    double coeffsNsPerCall;
+    double coeffsCyclesPerCall;
+};
+
+/**
+   Everything one filter needs, kept together and heap allocated because of the delay lines.
+ */
+struct QuadFilter {
+    sst::filters::QuadFilterUnitState state{};
+    sst::filters::FilterCoefficientMaker<> coeffMaker;
+    float delayLines[4][FilterKernels::kDelayLineSize];
+};
+
+/**
+   One frame of a quad group. A std::vector of them gives the 16-byte aligned rows the kernels load from.
+ */
+struct alignas(16) QuadFrame {
+    float lanes[4];
+};
+
+static const float kFreqNote = -12.0f;
+static const float kResonance = 0.5f;
+
+/**
+   Run @a body repeatedly for at least @a seconds and return the time and TSC ticks per call.
+ */
+template <typename Body>
+static void measure(double seconds, Body&& body, double& nsPerCall, double& cyclesPerCall)
+{
+    // warm up caches and branch predictors
+    for (int i = 0; i < 64; ++i)
+        body(i);
+
+    uint64_t calls = 0;
+    uint64_t cycles = 0;
+    double elapsed = 0.0;
+
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t startCycles = readCycles();
+
+    while (elapsed < seconds)
+    {
+        for (int i = 0; i < 256; ++i)
+            body(i);
+        calls += 256;
+
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        cycles = readCycles() - startCycles;
+    }
+
+    nsPerCall = elapsed * 1e9 / calls;
+    cyclesPerCall = (double)cycles / calls;
+}
+
+static Result runCase(const Options& opts, sst::filters::FilterType type, sst::filters::FilterSubType subType,
+                      const float* input, double copyNs, double copyCycles)
+{
+    std::unique_ptr<QuadFilter> filter(new QuadFilter());
+    sst::filters::FilterCoefficientMaker<>& coeffMaker = filter->coeffMaker;
+
+    coeffMaker.Reset();
+    coeffMaker.setSampleRateAndBlockSize((float)opts.sampleRate, opts.blockSize);
+    FilterKernels::resetState(filter->state, filter->delayLines, 4);
+
+    Result result = {};
+    result.type = type;
+    result.subType = subType;
+
+    // MakeCoeffs with the cutoff moving every call, so nothing is served from a steady state
+    measure(opts.seconds, [&](int i) {
+        coeffMaker.MakeCoeffs(kFreqNote + (i & 63) * 0.25f, kResonance, type, subType, nullptr, false);
+        coeffMaker.updateState(filter->state);
+    }, result.coeffsNsPerCall, result.coeffsCyclesPerCall);
+
+    // the filter runs on fixed coefficients, the way the plugin does once they settled
+    coeffMaker.Reset();
+    coeffMaker.MakeCoeffs(kFreqNote, kResonance, type, subType, nullptr, false);
+    FilterKernels::resetState(filter->state, filter->delayLines, 4);
+    for (int f = 0; f < sst::filters::n_cm_coeffs; ++f)
+    {
+        filter->state.C[f] = _mm_set1_ps(coeffMaker.C[f]);
+        filter->state.dC[f] = _mm_setzero_ps();
+    }
+
+    const FilterBlockKernel kernel = FilterKernels::get(type, subType);
+    const sst::filters::FilterUnitQFPtr unit = sst::filters::GetQFPtrFilterUnit(type, subType);
+    std::vector<QuadFrame> frames(opts.blockSize);
+    float* const work = frames[0].lanes;
+
+    // fresh input for every block, otherwise the signal decays towards denormals
+    double blockNs, blockCycles;
+    measure(opts.seconds, [&](int) {
+        std::memcpy(work, input, sizeof(float) * 4 * opts.blockSize);
+        kernel(unit, &filter->state, work, 4, opts.blockSize);
+    }, blockNs, blockCycles);
+
+    // the same filter through the unit pointer, from the same starting state
+    FilterKernels::resetState(filter->state, filter->delayLines, 4);
+    for (int f = 0; f < sst::filters::n_cm_coeffs; ++f)
+        filter->state.C[f] = _mm_set1_ps(coeffMaker.C[f]);
+
+    double genericNs, genericCycles;
+    measure(opts.seconds, [&](int) {
+        std::memcpy(work, input, sizeof(float) * 4 * opts.blockSize);
+        filterBlockKernelGeneric(unit, &filter->state, work, 4, opts.blockSize);
+    }, genericNs, genericCycles);
+
+    const double samples = 4.0 * opts.blockSize;
+    result.filterNsPerSample = std::max(0.0, blockNs - copyNs) / samples;
+    result.filterCyclesPerSample = std::max(0.0, blockCycles - copyCycles) / samples;
+    result.genericNsPerSample = std::max(0.0, genericNs - copyNs) / samples;
+
+    return result;
+}
+
+static void writeJson(FILE* const out, const Options& opts, const std::vector<Result>& results)
+{
+    double cheapest = 0.0;
+    for (const Result& r : results)
+    {
+        if (r.type != sst::filters::fut_none && r.filterNsPerSample > 0.0 &&
+            (cheapest == 0.0 || r.filterNsPerSample < cheapest))
+            cheapest = r.filterNsPerSample;
+    }
+
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"sampleRate\": %.0f,\n", opts.sampleRate);
+    std::fprintf(out, "  \"blockSize\": %u,\n", opts.blockSize);
+    std::fprintf(out, "  \"cyclesSource\": \"%s\",\n", BENCH_HAVE_TSC ? "tsc" : "none");
+    std::fprintf(out, "  \"results\": [\n");
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+        std::fprintf(out,
+                     "    { \"type\": %d, \"subtype\": %d, "
+                     "\"filterNsPerSample\": %.4f, \"filterCyclesPerSample\": %.4f, "
+                     "\"genericNsPerSample\": %.4f, \"kernelSpeedup\": %.3f, "
+                     "\"coeffsNsPerCall\": %.2f, \"coeffsCyclesPerCall\": %.2f, "
+                     "\"relativeFilterCost\": %.3f }%s\n",
+                     r.type, r.subType,
+                     r.filterNsPerSample, r.filterCyclesPerSample,
+                     r.genericNsPerSample, r.filterNsPerSample > 0.0 ? r.genericNsPerSample / r.filterNsPerSample : 0.0,
+                     r.coeffsNsPerCall, r.coeffsCyclesPerCall,
+                     cheapest > 0.0 ? r.filterNsPerSample / cheapest : 0.0,
+                     i + 1 < results.size() ? "," : "");
+    }
+
+    std::fprintf(out, "  ]\n}\n");
+}
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr, "usage: %s [--rate Hz] [--block frames] [--seconds s] [--type n] [--output file]\n", argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    Options opts;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+
+        if (arg == "--rate")
+            opts.sampleRate = std::atof(value);
+        else if (arg == "--block")
+            opts.blockSize = (uint32_t)std::atoi(value);
+        else if (arg == "--seconds")
+            opts.seconds = std::atof(value);
+        else if (arg == "--type")
+            opts.type = std::atoi(value);
+        else if (arg == "--output")
+            opts.output = value;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (opts.sampleRate < 8000.0 || opts.blockSize == 0 || opts.seconds <= 0.0 ||
+        opts.type >= sst::filters::num_filter_types)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // one block of noise per lane, frame-major like the plugin's work buffer
+    std::vector<float> input(4 * opts.blockSize);
+    NoiseSource noise(1);
+    for (float& v : input)
+        v = noise.next();
+
+    // the copy that refills every block is measured on its own and taken out of the filter cost
+    double copyNs, copyCycles;
+    {
+        std::vector<QuadFrame> frames(opts.blockSize);
+        float* const work = frames[0].lanes;
+        measure(opts.seconds, [&](int) {
+            std::memcpy(work, input.data(), sizeof(float) * 4 * opts.blockSize);
+#if defined(__GNUC__)
+            // keep the copy from being optimized away
+            __asm__ volatile("" : : "r"(work) : "memory");
+#endif
+        }, copyNs, copyCycles);
+    }
+
+    std::vector<Result> results;
+
+    for (int t = 0; t < sst::filters::num_filter_types; ++t)
+    {
+        if (opts.type >= 0 && t != opts.type)
+            continue;
+
+        for (int st = 0; st < FilterKernels::numSubTypes(t); ++st)
+        {
+            results.push_back(runCase(opts, sst::filters::FilterType(t), sst::filters::FilterSubType(st),
+                                      input.data(), copyNs, copyCycles));
+            std::fprintf(stderr, "type %d subtype %d: %.3f ns/sample, %.3f through the unit pointer\n", t, st,
+                         results.back().filterNsPerSample, results.back().genericNsPerSample);
+        }
+    }
+
+    FILE* const out = opts.output != nullptr ? std::fopen(opts.output, "w") : stdout;
+    if (out == nullptr)
+    {
+        std::fprintf(stderr, "cannot write %s\n", opts.output);
+        return 1;
+    }
+
+    writeJson(out, opts, results);
+
+    if (out != stdout)
+        std::fclose(out);
+
+    return 0;
+}
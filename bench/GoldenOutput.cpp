@@ -0,0 +1,463 @@
+/**
+ * Golden-output regression check of the plugin DSP.
+ *
+ * Renders a fixed set of stimuli (impulses, sweeps, noise and parameter automation) through the same FilterEngine
+ * ImGuiPluginDSP::run() forwards to, and compares the result against reference renders stored on disk.
+ * Blocks of irregular sizes are used so the chunking and remainder paths are covered too, and the scenarios also
+ * cover every type and subtype, every routing, the synth-filter mode, every oversampling factor and the quality tiers.
+ *
+ * Run with --update once on a known good build to write the references, then without it after every change.
+ * Comparison is bit-exact by default, --tolerance accepts any difference up to the given absolute error.
+ * Bit-exact references are only meaningful for the same compiler flags and instruction set (see LaneOps.hpp),
+ * use the tolerance mode to compare across machines, as the golden-output test does with the references in golden/.
+ *
+ * Scenarios marked for it are rendered a second time with the background coefficient thread, which has to stay
+ * within kBackgroundTolerance of the first render whatever the references, since under automation the engine glides
+ * towards coefficients the worker computed up to a sub-block behind. A missing reference fails like a mismatch does.
+ *
+ * Usage: imgui-demo-plugin-golden [--dir path] [--update] [--tolerance abs] [--scenario name]
+ */
+
+#include "BenchCommon.hpp"
+#include "DistrhoPluginInfo.h"
+#include "FilterEngine.hpp"
+#include "FilterKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------------------------------------------------
+
+typedef FilterEngine<PLUGIN_NUM_CHANNELS> Engine;
+typedef std::vector<std::vector<float>> Planar;
+
+static const double kSampleRate = 48000.0;
+
+// largest difference the background coefficient thread may make, 60 dB below full scale
+static const double kBackgroundTolerance = 1e-3;
+
+// block sizes the host hands out, cycled through while rendering
+static const uint32_t kBlockSizes[] = { 64, 1, 17, 256, 3, 128, 500, 4 };
+
+enum Stimulus {
+    kStimulusImpulse = 0,
+    kStimulusSweep,
+    kStimulusNoise,
+    kStimulusSine
+};
+
+struct NoteEvent {
+    uint32_t frame;
+    uint8_t key;
+    uint8_t velocity;
+};
+
+struct Scenario {
+    std::string name;
+    Stimulus stimulus;
+    double seconds;
+    int type;
+    int subType;
+    float freqNote;
+    float resonance;
+    // parameter changes made before the block starting at the given frame, may be null
+    std::function<void(Engine&, uint32_t frame, uint32_t totalFrames)> automate;
+    // settings made before activating the engine, may be null
+    std::function<void(Engine&)> setup = nullptr;
+    // MIDI notes, sorted by frame, a velocity of 0 is a note off
+    std::vector<NoteEvent> notes = {};
+    // also render with the background coefficient thread and require about the same output
+    bool checkBackground = false;
+};
+
+static void rampFrequency(Engine& e, uint32_t frame, uint32_t total)
+{
+    e.setFrequencyNote(-48.0f + 112.0f * frame / total);
+}
+
+static std::vector<Scenario> makeScenarios()
+{
+    using namespace sst::filters;
+
+    std::vector<Scenario> list = {
+        { "impulse-ladder", kStimulusImpulse, 1.0, fut_vintageladder, 0, -12.0f, 0.7f, nullptr },
+        { "impulse-lp12", kStimulusImpulse, 1.0, fut_lp12, 0, 0.0f, 0.5f, nullptr },
+        { "sweep-ladder", kStimulusSweep, 2.0, fut_vintageladder, 0, 12.0f, 0.9f, nullptr },
+        { "noise-lp24", kStimulusNoise, 1.0, fut_lp24, 0, -12.0f, 0.3f, nullptr },
+        { "noise-bp12", kStimulusNoise, 1.0, fut_bp12, 0, 0.0f, 0.5f, nullptr },
+        { "noise-comb", kStimulusNoise, 1.0, fut_comb_pos, 0, 24.0f, 0.5f, nullptr },
+        { "freq-ramp", kStimulusNoise, 2.0, fut_vintageladder, 0, -48.0f, 0.6f, rampFrequency, nullptr, {}, true },
+        { "res-ramp", kStimulusSine, 2.0, fut_lpmoog, 0, 0.0f, 0.0f,
+          [](Engine& e, uint32_t frame, uint32_t total) {
+              e.setResonance((float)frame / total);
+          }, nullptr, {}, true },
+        { "gain-steps", kStimulusSine, 1.0, fut_lp12, 0, 24.0f, 0.2f,
+          [](Engine& e, uint32_t frame, uint32_t) {
+              e.setGainDB((frame / 4800) % 2 == 0 ? 0.0f : -24.0f);
+          } },
+        { "dry-wet", kStimulusNoise, 1.0, fut_lp24, 0, -24.0f, 0.5f,
+          [](Engine& e, uint32_t frame, uint32_t total) {
+              e.setMix(1.0f - (float)frame / total);
+          } },
+        { "type-change", kStimulusNoise, 1.0, fut_vintageladder, 0, 0.0f, 0.5f,
+          [](Engine& e, uint32_t frame, uint32_t total) {
+              e.setFilterType(frame < total / 2 ? fut_vintageladder : fut_lp24);
+              e.setFilterSubType(frame < total / 4 || frame >= total * 3 / 4 ? 0 : 1);
+          }, nullptr, {}, true },
+        { "serial-bp12", kStimulusNoise, 1.0, fut_lp24, 0, 12.0f, 0.3f,
+          [](Engine& e, uint32_t, uint32_t) {
+              e.setRouting(Engine::kRoutingSerial);
+              e.setFilterType(fut_bp12, 1);
+              e.setFrequencyNote(0.0f, 1);
+          }, nullptr, {}, true },
+        { "feedback-ladder", kStimulusImpulse, 1.0, fut_vintageladder, 0, -12.0f, 0.5f,
+          [](Engine& e, uint32_t frame, uint32_t total) {
+              e.setRouting(Engine::kRoutingFeedback);
+              e.setFilterType(fut_lp12, 1);
+              e.setFrequencyNote(12.0f, 1);
+              e.setFeedback((float)frame / total);
+          } },
+        { "drive-ladder", kStimulusSweep, 1.0, fut_vintageladder, 0, 0.0f, 0.6f,
+          [](Engine& e, uint32_t frame, uint32_t total) {
+              e.setDriveShape(Engine::kNumDriveShapes - 1 - (int)(4u * frame / total));
+              e.setDriveDB(24.0f * frame / total);
+          } },
+        { "os2-sweep", kStimulusSweep, 1.0, fut_vintageladder, 0, 24.0f, 0.7f, nullptr,
+          [](Engine& e) { e.setOversampling(2); } },
+        { "os4-freq-ramp", kStimulusNoise, 1.0, fut_lp24, 0, -48.0f, 0.5f, rampFrequency,
+          [](Engine& e) { e.setOversampling(4); }, {}, true },
+        { "os8-noise", kStimulusNoise, 1.0, fut_lpmoog, 0, 36.0f, 0.8f, nullptr,
+          [](Engine& e) { e.setOversampling(8); } },
+        { "eco-freq-ramp", kStimulusNoise, 1.0, fut_vintageladder, 0, -48.0f, 0.6f, rampFrequency,
+          [](Engine& e) { e.setQuality(Engine::kQualityEco); }, {}, true },
+        { "high-freq-ramp", kStimulusNoise, 1.0, fut_vintageladder, 0, -48.0f, 0.6f, rampFrequency,
+          [](Engine& e) { e.setQuality(Engine::kQualityHigh); }, {}, true },
+        { "poly-notes", kStimulusNoise, 1.0, fut_lp24, 0, 12.0f, 0.5f, nullptr,
+          [](Engine& e) {
+              e.setPolyMode(true);
+              e.setKeyTrack(1.0f);
+              e.setVelocityToResonance(0.5f);
+          },
+          { { 0, 48, 100 }, { 6001, 60, 64 }, { 6001, 64, 127 }, { 20000, 48, 0 }, { 24000, 67, 90 },
+            { 30000, 60, 0 }, { 36000, 64, 0 }, { 40000, 67, 0 } },
+          true },
+        { "parallel-lp-bp", kStimulusNoise, 1.0, fut_lp24, 0, -12.0f, 0.4f,
+          [](Engine& e, uint32_t, uint32_t) {
+              e.setRouting(Engine::kRoutingParallel);
+              e.setFilterType(fut_bp12, 1);
+              e.setFrequencyNote(24.0f, 1);
+          } },
+        { "stereo-ladder-comb", kStimulusNoise, 1.0, fut_vintageladder, 0, -12.0f, 0.6f,
+          [](Engine& e, uint32_t frame, uint32_t total) {
+              e.setRouting(Engine::kRoutingStereo);
+              e.setFilterType(fut_comb_pos, 1);
+              e.setFrequencyNote(-24.0f + 48.0f * frame / total, 1);
+          }, nullptr, {}, true },
+    };
+
+    // every subtype of every type, under a frequency ramp so the coefficient updates are covered as well
+    for (int t = 0; t < num_filter_types; ++t)
+    {
+        for (int st = 0; st < FilterKernels::numSubTypes(t); ++st)
+        {
+            list.push_back({ "type" + std::to_string(t) + "-sub" + std::to_string(st), kStimulusNoise, 0.25, t, st,
+                             -48.0f, 0.5f, rampFrequency });
+        }
+    }
+
+    return list;
+}
+
+static const std::vector<Scenario>& scenarios()
+{
+    static const std::vector<Scenario> list = makeScenarios();
+    return list;
+}
+
+static Planar renderStimulus(const Scenario& scenario, uint32_t frames)
+{
+    Planar buffer(PLUGIN_NUM_CHANNELS, std::vector<float>(frames, 0.0f));
+
+    for (uint32_t c = 0; c < PLUGIN_NUM_CHANNELS; ++c)
+    {
+        std::vector<float>& channel = buffer[c];
+        NoiseSource noise(0x9E3779B9u * (c + 1));
+        double phase = 0.0;
+
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            switch (scenario.stimulus) {
+            case kStimulusImpulse:
+                // one impulse every 250 ms, offset per channel
+                channel[i] = (i + c * 7) % 12000 == 0 ? 1.0f : 0.0f;
+                break;
+            case kStimulusSweep:
+                // logarithmic sweep from 20 Hz to 20 kHz
+                phase += 2.0 * M_PI * 20.0 * std::pow(1000.0, (double)i / frames) / kSampleRate;
+                channel[i] = (float)(0.5 * std::sin(phase));
+                break;
+            case kStimulusNoise:
+                channel[i] = noise.next();
+                break;
+            case kStimulusSine:
+                phase += 2.0 * M_PI * (110.0 * (c + 1)) / kSampleRate;
+                channel[i] = (float)(0.5 * std::sin(phase));
+                break;
+            }
+        }
+    }
+
+    return buffer;
+}
+
+static Planar renderScenario(const Scenario& scenario, bool backgroundCoeffs)
+{
+    const uint32_t frames = (uint32_t)(scenario.seconds * kSampleRate);
+    const Planar input = renderStimulus(scenario, frames);
+    Planar output(PLUGIN_NUM_CHANNELS, std::vector<float>(frames, 0.0f));
+
+    std::unique_ptr<Engine> engine(new Engine());
+    engine->setSampleRate(kSampleRate);
+    engine->setFilterType(scenario.type);
+    engine->setFilterSubType(scenario.subType);
+    engine->setFrequencyNote(scenario.freqNote);
+    engine->setResonance(scenario.resonance);
+    engine->setGainDB(0.0f);
+    if (scenario.setup)
+        scenario.setup(*engine);
+    engine->setBackgroundCoeffs(backgroundCoeffs);
+    engine->activate();
+
+    const float* inPtrs[PLUGIN_NUM_CHANNELS];
+    float* outPtrs[PLUGIN_NUM_CHANNELS];
+
+    uint32_t blockIndex = 0;
+    size_t noteIndex = 0;
+    for (uint32_t offset = 0; offset < frames; ++blockIndex)
+    {
+        const uint32_t blockEnd = offset + MIN(kBlockSizes[blockIndex % (sizeof(kBlockSizes) / sizeof(kBlockSizes[0]))],
+                                               frames - offset);
+
+        if (scenario.automate)
+            scenario.automate(*engine, offset, frames);
+
+        // split the block at the notes, the way ImGuiPluginDSP::run() does
+        for (uint32_t start = offset; start < blockEnd;)
+        {
+            for (; noteIndex < scenario.notes.size() && scenario.notes[noteIndex].frame <= start; ++noteIndex)
+                engine->noteOn(scenario.notes[noteIndex].key, scenario.notes[noteIndex].velocity);
+
+            const uint32_t end = noteIndex < scenario.notes.size() ? MIN(scenario.notes[noteIndex].frame, blockEnd)
+                                                                   : blockEnd;
+
+            for (uint32_t c = 0; c < PLUGIN_NUM_CHANNELS; ++c)
+            {
+                inPtrs[c] = &input[c][start];
+                outPtrs[c] = &output[c][start];
+            }
+
+            engine->process(inPtrs, outPtrs, end - start);
+            start = end;
+        }
+
+        offset = blockEnd;
+    }
+
+    return output;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// Reference files: a small header followed by the planar float samples of every channel
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t channels;
+    uint32_t frames;
+};
+
+static bool writeReference(const std::string& path, const Planar& data)
+{
+    FILE* const f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr)
+        return false;
+
+    const FileHeader header = { { 'G', 'O', 'L', 'D' }, 1, (uint32_t)data.size(), (uint32_t)data[0].size() };
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+
+    for (const std::vector<float>& channel : data)
+        ok = ok && std::fwrite(channel.data(), sizeof(float), channel.size(), f) == channel.size();
+
+    return std::fclose(f) == 0 && ok;
+}
+
+static bool readReference(const std::string& path, Planar& data)
+{
+    FILE* const f = std::fopen(path.c_str(), "rb");
+    if (f == nullptr)
+        return false;
+
+    FileHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, f) == 1 &&
+              std::memcmp(header.magic, "GOLD", 4) == 0 && header.version == 1 &&
+              header.channels != 0 && header.frames != 0;
+
+    if (ok)
+    {
+        data.assign(header.channels, std::vector<float>(header.frames));
+        for (std::vector<float>& channel : data)
+            ok = ok && std::fread(channel.data(), sizeof(float), channel.size(), f) == channel.size();
+    }
+
+    std::fclose(f);
+    return ok;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+/**
+   Compare @a output against @a reference, bit for bit when @a tolerance is negative.
+ */
+static bool compare(const char* name, const Planar& output, const Planar& reference, double tolerance)
+{
+    if (output.size() != reference.size() || output[0].size() != reference[0].size())
+    {
+        std::printf("FAIL %-20s reference has %zu channels and %zu frames, expected %zu and %zu\n",
+                    name, reference.size(), reference[0].size(), output.size(), output[0].size());
+        return false;
+    }
+
+    double maxError = 0.0, peak = 0.0;
+    uint32_t worstChannel = 0, worstFrame = 0, mismatches = 0;
+
+    for (uint32_t c = 0; c < output.size(); ++c)
+    {
+        for (uint32_t i = 0; i < output[c].size(); ++i)
+        {
+            const float out = output[c][i];
+            const float ref = reference[c][i];
+
+            peak = std::max(peak, (double)std::fabs(ref));
+
+            if (std::memcmp(&out, &ref, sizeof(float)) != 0)
+                ++mismatches;
+
+            // a NaN on either side counts as an infinite error
+            const double error = out == ref ? 0.0 : std::isnan(out) || std::isnan(ref) ? INFINITY
+                                                  : std::fabs((double)out - ref);
+            if (error > maxError)
+            {
+                maxError = error;
+                worstChannel = c;
+                worstFrame = i;
+            }
+        }
+    }
+
+    const bool pass = tolerance < 0.0 ? mismatches == 0 : maxError <= tolerance;
+    const double errorDB = maxError > 0.0 && peak > 0.0 ? 20.0 * std::log10(maxError / peak) : -INFINITY;
+
+    std::printf("%s %-20s %u samples differ, max error %g (%.1f dB below peak) at channel %u frame %u\n",
+                pass ? "PASS" : "FAIL", name, mismatches, maxError, -errorDB, worstChannel, worstFrame);
+    return pass;
+}
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr, "usage: %s [--dir path] [--update] [--tolerance abs] [--scenario name]\n", argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string dir = "golden";
+    std::string only;
+    bool update = false;
+    double tolerance = -1.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "--update")
+        {
+            update = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+
+        if (arg == "--dir")
+            dir = value;
+        else if (arg == "--tolerance")
+            tolerance = std::atof(value);
+        else if (arg == "--scenario")
+            only = value;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    int failures = 0, ran = 0;
+
+    for (const Scenario& scenario : scenarios())
+    {
+        if (! only.empty() && only != scenario.name)
+            continue;
+        ++ran;
+
+        const std::string path = dir + "/" + scenario.name + "-" + std::to_string(PLUGIN_NUM_CHANNELS) + "ch.gold";
+        const Planar output = renderScenario(scenario, false);
+
+        if (scenario.checkBackground && ! compare((scenario.name + " (bg)").c_str(), output,
+                                                  renderScenario(scenario, true), kBackgroundTolerance))
+            ++failures;
+
+        if (update)
+        {
+            if (writeReference(path, output))
+            {
+                std::printf("wrote %s\n", path.c_str());
+            }
+            else
+            {
+                std::printf("FAIL %-20s cannot write %s\n", scenario.name.c_str(), path.c_str());
+                ++failures;
+            }
+            continue;
+        }
+
+        Planar reference;
+        if (! readReference(path, reference))
+        {
+            std::printf("FAIL %-20s missing or invalid reference %s, run with --update\n", scenario.name.c_str(),
+                        path.c_str());
+            ++failures;
+            continue;
+        }
+
+        if (! compare(scenario.name.c_str(), output, reference, tolerance))
+            ++failures;
+    }
+
+    if (ran == 0)
+    {
+        std::fprintf(stderr, "no scenario named %s\n", only.c_str());
+        return 1;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
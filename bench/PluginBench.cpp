@@ -0,0 +1,439 @@
+/**
+ * Offline benchmark of the plugin DSP.
+ *
+ * Drives the same FilterEngine ImGuiPluginDSP::run() forwards to, without a host or UI, over a synthetic signal
+ * at a given sample rate and block size, and reports the cost per sample and how many channels fit in realtime.
+ *
+ * Usage: imgui-demo-plugin-bench [--rate Hz] [--block frames] [--seconds s] [--channels n]
+ *                                [--signal noise|sine|sweep|silence|decay] [--type n] [--subtype n]
+ *                                [--control-block frames] [--quality eco|normal|high]
+ *                                [--oversampling 0|1|2|4|8] [--coeff-cache KiB] [--background-coeffs]
+ *                                [--voices n] [--routing single|serial|parallel|stereo|feedback]
+ *                                [--type2 n] [--drive off|soft|tanh|asym|fold] [--drive-db dB]
+ *                                [--automate] [--no-sleep] [--slices n]
+ *
+ * The decay signal is a short noise burst followed by silence, with --no-sleep the filters keep running through
+ * the tail and --slices shows the cost over the course of the decay, which stays flat while denormals are flushed.
+ * --voices runs the polyphonic synth-filter mode with that many notes held, spread over the keyboard.
+ * --routing adds a second filter stage of type --type2, an octave above the first one, with 50% feedback in the
+ * feedback routing. --drive adds the drive stage in front of the first filter stage, at 18 dB unless --drive-db
+ * says otherwise.
+ */
+
+#include "BenchCommon.hpp"
+#include "DistrhoPluginInfo.h"
+#include "FilterEngine.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------------------------------------------------
+
+enum Signal {
+    kSignalNoise = 0,
+    kSignalSine,
+    kSignalSweep,
+    kSignalSilence,
+    kSignalDecay
+};
+
+struct Options {
+    double sampleRate = 48000.0;
+    uint32_t blockSize = 256;
+    double seconds = 10.0;
+    uint32_t channels = PLUGIN_NUM_CHANNELS;
+    Signal signal = kSignalNoise;
+    int type = sst::filters::fut_vintageladder;
+    int subType = 0;
+    uint32_t controlBlockSize = PLUGIN_CONTROL_BLOCK_SIZE;
+    int quality = FilterEngine<PLUGIN_NUM_CHANNELS>::kQualityNormal;
+    uint32_t oversampling = 0;
+    uint32_t coeffCacheKB = PLUGIN_COEFF_CACHE_KB;
+    bool backgroundCoeffs = false;
+    uint32_t voices = 0;
+    int routing = FilterEngine<PLUGIN_NUM_CHANNELS>::kRoutingSingle;
+    int type2 = sst::filters::fut_vintageladder;
+    int drive = 0;
+    float driveDB = 18.0f;
+    bool automate = false;
+    bool sleep = true;
+    uint32_t slices = 0;
+};
+
+static const char* const kSignalNames[] = { "noise", "sine", "sweep", "silence", "decay" };
+static const char* const kQualityNames[] = { "eco", "normal", "high" };
+static const char* const kRoutingNames[] = { "single", "serial", "parallel", "stereo", "feedback" };
+static const char* const kDriveNames[] = { "off", "soft", "tanh", "asym", "fold" };
+
+/**
+   Render one second of @a signal for @a channel, rounded up to a whole number of blocks so it loops seamlessly.
+ */
+static std::vector<float> renderSignal(const Options& opts, uint32_t channel, uint32_t frames)
+{
+    std::vector<float> buffer(frames);
+    NoiseSource noise(0x9E3779B9u * (channel + 1));
+    double phase = 0.0;
+
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        const double t = (double)i / frames;
+
+        switch (opts.signal) {
+        case kSignalNoise:
+            buffer[i] = noise.next();
+            break;
+        case kSignalSine:
+            phase += 2.0 * M_PI * 440.0 / opts.sampleRate;
+            buffer[i] = (float)(0.5 * std::sin(phase));
+            break;
+        case kSignalSweep:
+            // logarithmic sweep from 20 Hz to 20 kHz
+            phase += 2.0 * M_PI * 20.0 * std::pow(1000.0, t) / opts.sampleRate;
+            buffer[i] = (float)(0.5 * std::sin(phase));
+            break;
+        case kSignalSilence:
+            buffer[i] = 0.0f;
+            break;
+        case kSignalDecay:
+            // 10 ms of noise, then the filter tail for the rest of the second
+            buffer[i] = i < opts.sampleRate * 0.01 ? noise.next() : 0.0f;
+            break;
+        }
+    }
+
+    return buffer;
+}
+
+template <uint32_t NumChannels>
+static int runBench(const Options& opts)
+{
+    std::unique_ptr<FilterEngine<NumChannels>> engine(new FilterEngine<NumChannels>());
+
+    engine->setSampleRate(opts.sampleRate);
+    engine->setControlBlockSize(opts.controlBlockSize);
+    engine->setQuality(opts.quality);
+    engine->setOversampling(opts.oversampling);
+    engine->setCoeffCacheSize(opts.coeffCacheKB);
+    engine->setBackgroundCoeffs(opts.backgroundCoeffs);
+    engine->setSleepEnabled(opts.sleep);
+    engine->setFilterType(opts.type);
+    engine->setFilterSubType(opts.subType);
+    engine->setFrequencyNote(-12.0f);
+    engine->setResonance(0.5f);
+    engine->setGainDB(0.0f);
+    engine->setRouting(opts.routing);
+    engine->setFilterType(opts.type2, 1);
+    engine->setFrequencyNote(0.0f, 1);
+    engine->setResonance(0.5f, 1);
+    engine->setFeedback(0.5f);
+    engine->setDriveShape(opts.drive);
+    engine->setDriveDB(opts.driveDB);
+    engine->setPolyMode(opts.voices != 0);
+    if (opts.voices != 0)
+        engine->setPolyphony(opts.voices);
+    engine->activate();
+
+    // a chord of fifths upwards from C2, held for the whole run
+    for (uint32_t v = 0; v < opts.voices; ++v)
+        engine->noteOn((uint8_t)(36 + v * 7 % 48), 100);
+
+    const uint32_t loopFrames = ((uint32_t)opts.sampleRate + opts.blockSize - 1) / opts.blockSize * opts.blockSize;
+    const uint64_t totalBlocks = (uint64_t)(opts.seconds * opts.sampleRate / opts.blockSize) + 1;
+
+    std::vector<std::vector<float>> inputs, outputs;
+    for (uint32_t c = 0; c < NumChannels; ++c)
+    {
+        inputs.push_back(renderSignal(opts, c, loopFrames));
+        outputs.emplace_back(opts.blockSize);
+    }
+
+    std::vector<const float*> inPtrs(NumChannels);
+    std::vector<float*> outPtrs(NumChannels);
+    for (uint32_t c = 0; c < NumChannels; ++c)
+        outPtrs[c] = outputs[c].data();
+
+    double checksum = 0.0;
+
+    // time spent in and frames processed by each slice of the signal loop
+    std::vector<double> sliceTime(opts.slices), sliceFrames(opts.slices);
+
+    auto processBlock = [&](uint64_t block) {
+        const uint32_t offset = (uint32_t)((block * opts.blockSize) % loopFrames);
+
+        if (opts.automate)
+        {
+            // move the cutoff every block, a triangle over two seconds
+            const double t = std::fmod(block * opts.blockSize / opts.sampleRate, 2.0);
+            engine->setFrequencyNote((float)(-48.0 + 80.0 * (t < 1.0 ? t : 2.0 - t)));
+        }
+
+        for (uint32_t c = 0; c < NumChannels; ++c)
+            inPtrs[c] = &inputs[c][offset];
+
+        engine->process(inPtrs.data(), outPtrs.data(), opts.blockSize);
+        checksum += outputs[0][opts.blockSize - 1];
+    };
+
+    // settle caches, branch predictors and coefficient smoothing before measuring
+    const uint64_t warmupBlocks = MAX((uint64_t)1, totalBlocks / 10);
+    for (uint64_t b = 0; b < warmupBlocks; ++b)
+        processBlock(b);
+
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t startCycles = readCycles();
+
+    for (uint64_t b = 0; b < totalBlocks; ++b)
+    {
+        if (opts.slices == 0)
+        {
+            processBlock(warmupBlocks + b);
+            continue;
+        }
+
+        const uint32_t offset = (uint32_t)(((warmupBlocks + b) * opts.blockSize) % loopFrames);
+        const uint32_t slice = (uint32_t)((uint64_t)offset * opts.slices / loopFrames);
+
+        const auto blockStart = std::chrono::steady_clock::now();
+        processBlock(warmupBlocks + b);
+        sliceTime[slice] += std::chrono::duration<double>(std::chrono::steady_clock::now() - blockStart).count();
+        sliceFrames[slice] += opts.blockSize;
+    }
+
+    const uint64_t cycles = readCycles() - startCycles;
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const double frames = (double)totalBlocks * opts.blockSize;
+    const double samples = frames * NumChannels;
+    const double realtimeFactor = frames / opts.sampleRate / elapsed;
+
+    std::printf("type %d, subtype %d, %u channels, %s, %.0f Hz, block %u, control block %u, %s quality, "
+                "oversampling %s, coefficient cache %u KiB%s%s%s%s%s%s\n",
+                opts.type, opts.subType, NumChannels, kSignalNames[opts.signal], opts.sampleRate,
+                opts.blockSize, opts.controlBlockSize, kQualityNames[opts.quality],
+                opts.oversampling != 0 ? std::to_string(opts.oversampling).append("x").c_str() : "auto",
+                engine->getCoeffCacheSize() / 1024,
+                opts.backgroundCoeffs ? ", background coefficients" : "",
+                opts.voices != 0 ? (", " + std::to_string(opts.voices) + " voices").c_str() : "",
+                opts.routing != FilterEngine<NumChannels>::kRoutingSingle
+                    ? (std::string(", ") + kRoutingNames[opts.routing] + " into type "
+                       + std::to_string(opts.type2)).c_str()
+                    : "",
+                opts.drive != 0
+                    ? (std::string(", ") + kDriveNames[opts.drive] + " drive at "
+                       + std::to_string((int)opts.driveDB) + " dB").c_str()
+                    : "",
+                opts.automate ? ", automated" : "",
+                opts.sleep ? "" : ", no sleep");
+    std::printf("  ns/sample            %10.3f\n", elapsed * 1e9 / samples);
+#if BENCH_HAVE_TSC
+    std::printf("  cycles/sample        %10.3f (TSC)\n", cycles / samples);
+#else
+    (void)cycles;
+    std::printf("  cycles/sample               n/a\n");
+#endif
+    std::printf("  realtime factor      %10.1f x\n", realtimeFactor);
+    std::printf("  channels in realtime %10.1f\n", realtimeFactor * NumChannels);
+    std::printf("  checksum             %10g\n", checksum);
+    if (opts.voices != 0)
+        std::printf("  voice quad states    %10u\n", engine->getActiveVoiceStates());
+
+    if (opts.slices != 0)
+    {
+        double fastest = 0.0, slowest = 0.0;
+
+        for (uint32_t i = 0; i < opts.slices; ++i)
+        {
+            if (sliceFrames[i] == 0.0)
+                continue;
+
+            const double ns = sliceTime[i] * 1e9 / (sliceFrames[i] * NumChannels);
+            fastest = fastest == 0.0 ? ns : MIN(fastest, ns);
+            slowest = MAX(slowest, ns);
+            std::printf("  slice %3u at %6.3f s %10.3f ns/sample\n",
+                        i, (double)i / opts.slices * loopFrames / opts.sampleRate, ns);
+        }
+
+        std::printf("  slowest/fastest      %10.2f\n", fastest > 0.0 ? slowest / fastest : 0.0);
+    }
+
+    return 0;
+}
+
+static int dispatch(const Options& opts)
+{
+    if (opts.channels == PLUGIN_NUM_CHANNELS)
+        return runBench<PLUGIN_NUM_CHANNELS>(opts);
+
+    // a handful of common widths besides the one the plugin is built with
+    switch (opts.channels) {
+    case 1:  return runBench<1>(opts);
+    case 2:  return runBench<2>(opts);
+    case 4:  return runBench<4>(opts);
+    case 8:  return runBench<8>(opts);
+    case 16: return runBench<16>(opts);
+    case 32: return runBench<32>(opts);
+    case 64: return runBench<64>(opts);
+    }
+
+    std::fprintf(stderr, "unsupported channel count %u, use 1, 2, 4, 8, 16, 32, 64 or %d\n",
+                 opts.channels, PLUGIN_NUM_CHANNELS);
+    return 1;
+}
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [--rate Hz] [--block frames] [--seconds s] [--channels n]\n"
+                 "          [--signal noise|sine|sweep|silence|decay] [--type n] [--subtype n]\n"
+                 "          [--control-block frames] [--quality eco|normal|high]\n"
+                 "          [--oversampling 0|1|2|4|8] [--coeff-cache KiB] [--background-coeffs]\n"
+                 "          [--voices n] [--routing single|serial|parallel|stereo|feedback]\n"
+                 "          [--type2 n] [--drive off|soft|tanh|asym|fold] [--drive-db dB]\n"
+                 "          [--automate] [--no-sleep] [--slices n]\n", argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    Options opts;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (arg == "--automate")
+        {
+            opts.automate = true;
+            continue;
+        }
+
+        if (arg == "--background-coeffs")
+        {
+            opts.backgroundCoeffs = true;
+            continue;
+        }
+
+        if (arg == "--no-sleep")
+        {
+            opts.sleep = false;
+            continue;
+        }
+
+        if (value == nullptr)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        ++i;
+
+        if (arg == "--rate")
+            opts.sampleRate = std::atof(value);
+        else if (arg == "--block")
+            opts.blockSize = (uint32_t)std::atoi(value);
+        else if (arg == "--seconds")
+            opts.seconds = std::atof(value);
+        else if (arg == "--channels")
+            opts.channels = (uint32_t)std::atoi(value);
+        else if (arg == "--type")
+            opts.type = std::atoi(value);
+        else if (arg == "--subtype")
+            opts.subType = std::atoi(value);
+        else if (arg == "--control-block")
+            opts.controlBlockSize = (uint32_t)std::atoi(value);
+        else if (arg == "--slices")
+            opts.slices = (uint32_t)std::atoi(value);
+        else if (arg == "--oversampling")
+            opts.oversampling = (uint32_t)std::atoi(value);
+        else if (arg == "--coeff-cache")
+            opts.coeffCacheKB = (uint32_t)std::atoi(value);
+        else if (arg == "--voices")
+            opts.voices = (uint32_t)std::atoi(value);
+        else if (arg == "--type2")
+            opts.type2 = std::atoi(value);
+        else if (arg == "--drive-db")
+            opts.driveDB = (float)std::atof(value);
+        else if (arg == "--drive")
+        {
+            bool found = false;
+            for (int d = 0; d < FilterEngine<PLUGIN_NUM_CHANNELS>::kNumDriveShapes; ++d)
+            {
+                if (std::string(value) != kDriveNames[d])
+                    continue;
+                opts.drive = d;
+                found = true;
+            }
+            if (! found)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--routing")
+        {
+            bool found = false;
+            for (int r = 0; r < FilterEngine<PLUGIN_NUM_CHANNELS>::kRoutingCount; ++r)
+            {
+                if (std::string(value) != kRoutingNames[r])
+                    continue;
+                opts.routing = r;
+                found = true;
+            }
+            if (! found)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--quality")
+        {
+            bool found = false;
+            for (int q = 0; q < FilterEngine<PLUGIN_NUM_CHANNELS>::kQualityCount; ++q)
+            {
+                if (std::string(value) != kQualityNames[q])
+                    continue;
+                opts.quality = q;
+                found = true;
+            }
+            if (! found)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--signal")
+        {
+            bool found = false;
+            for (int s = 0; s <= kSignalDecay; ++s)
+            {
+                if (std::string(value) != kSignalNames[s])
+                    continue;
+                opts.signal = Signal(s);
+                found = true;
+            }
+            if (! found)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (opts.sampleRate < 8000.0 || opts.blockSize == 0 || opts.seconds <= 0.0 ||
+        (opts.oversampling & (opts.oversampling - 1)) != 0 || opts.oversampling > 8 || opts.voices > 16)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    return dispatch(opts);
+}
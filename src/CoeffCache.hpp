@@ -0,0 +1,165 @@
+/**
+ * Lookup cache of filter coefficients over the frequency and resonance ranges of the plugin.
+ *
+ * FilterCoefficientMaker::MakeCoeffs runs a handful of transcendental functions for every update, which dominates
+ * the profile once cutoff is modulated every sub-block. The cache holds a grid of target coefficients for one
+ * filter type and subtype at one sample rate, and interpolates bilinearly between the four grid points around the
+ * requested note and resonance. Grid points are computed the first time a lookup needs them, so selecting a type
+ * costs nothing up front and a sweep only pays for MakeCoeffs once per point it crosses.
+ * The grid resolution follows a memory budget, set while the engine is deactivated.
+ */
+
+#ifndef COEFF_CACHE_H
+#define COEFF_CACHE_H
+
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+#include <sst/filters.h>
+
+class CoeffCache {
+public:
+    // range covered by the grid, the one of the FrequencyNote and Resonance parameters
+    static constexpr float kMinNote = -60.0f;
+    static constexpr float kMaxNote = 64.0f;
+    static constexpr float kMinRes = 0.0f;
+    static constexpr float kMaxRes = 1.0f;
+
+   /**
+      Size the grid for at most @a bytes of coefficients, 0 disables the cache.@n
+      Allocates, so only while the engine is deactivated.
+    */
+    void setBudget(uint32_t bytes)
+    {
+        // grid points per semitone, halved until the grid fits, resonance gets a point every 1/16 at 1 per semitone
+        fNoteSteps = fResSteps = 0;
+        for (int shift = kMaxShift; shift >= kMinShift; --shift)
+        {
+            const float perSemitone = std::ldexp(1.0f, shift);
+            const uint32_t noteSteps = (uint32_t)((kMaxNote - kMinNote) * perSemitone);
+            const uint32_t resSteps = (uint32_t)(16.0f * perSemitone);
+            if ((uint64_t)(noteSteps + 1) * (resSteps + 1) * sizeof(Point) <= bytes)
+            {
+                fNoteSteps = noteSteps;
+                fResSteps = resSteps;
+                break;
+            }
+        }
+
+        const uint32_t numPoints = isEnabled() ? (fNoteSteps + 1) * (fResSteps + 1) : 0;
+        fPoints.assign(numPoints, Point());
+        fValid.assign(numPoints, 0);
+        fType = sst::filters::fut_none;
+    }
+
+    bool isEnabled() const noexcept
+    {
+        return fNoteSteps != 0;
+    }
+
+   /**
+      Whether @a note lies on the grid. Lookups clamp to its edges, so notes beyond them, like key-tracked cutoffs
+      of the synth-filter mode, have to be computed directly.
+    */
+    static bool covers(float note) noexcept
+    {
+        return note >= kMinNote && note <= kMaxNote;
+    }
+
+   /**
+      Bytes taken by the grid.
+    */
+    uint32_t getSize() const noexcept
+    {
+        return (uint32_t)(fPoints.size() * sizeof(Point));
+    }
+
+   /**
+      Write to @a coeffs the target coefficients of @a type and @a subType at @a sampleRate, for @a note and @a res.@n
+      A different type, subtype or sample rate than the last call starts the grid over.
+    */
+    void lookup(float note, float res, sst::filters::FilterType type, sst::filters::FilterSubType subType,
+                float sampleRate, float (&coeffs)[sst::filters::n_cm_coeffs])
+    {
+        if (type != fType || subType != fSubType || sampleRate != fSampleRate)
+        {
+            std::memset(fValid.data(), 0, fValid.size());
+            fType = type;
+            fSubType = subType;
+            fSampleRate = sampleRate;
+            fMaker.setSampleRateAndBlockSize(sampleRate, 1);
+        }
+
+        const float x = clampToGrid((note - kMinNote) * fNoteSteps / (kMaxNote - kMinNote), fNoteSteps);
+        const float y = clampToGrid((res - kMinRes) * fResSteps / (kMaxRes - kMinRes), fResSteps);
+        const uint32_t i = (uint32_t)x < fNoteSteps ? (uint32_t)x : fNoteSteps - 1;
+        const uint32_t j = (uint32_t)y < fResSteps ? (uint32_t)y : fResSteps - 1;
+        const float fx = x - i;
+        const float fy = y - j;
+
+        const float* const c00 = point(i, j);
+        const float* const c10 = point(i + 1, j);
+        const float* const c01 = point(i, j + 1);
+        const float* const c11 = point(i + 1, j + 1);
+
+        for (int f = 0; f < sst::filters::n_cm_coeffs; ++f)
+        {
+            const float low = c00[f] + (c10[f] - c00[f]) * fx;
+            const float high = c01[f] + (c11[f] - c01[f]) * fx;
+            coeffs[f] = low + (high - low) * fy;
+        }
+    }
+
+private:
+    // finest and coarsest grids, 8 and 1/4 points per semitone
+    static constexpr int kMaxShift = 3;
+    static constexpr int kMinShift = -2;
+
+    struct Point {
+        float coeffs[sst::filters::n_cm_coeffs];
+    };
+
+    uint32_t fNoteSteps = 0;
+    uint32_t fResSteps = 0;
+    std::vector<Point> fPoints;
+    std::vector<uint8_t> fValid;
+
+    // what the grid currently holds
+    sst::filters::FilterType fType = sst::filters::fut_none;
+    sst::filters::FilterSubType fSubType = sst::filters::FilterSubType(0);
+    float fSampleRate = 0.0f;
+
+    // computes the grid points, a first MakeCoeffs after Reset lands right on the target
+    sst::filters::FilterCoefficientMaker<> fMaker;
+
+    static float clampToGrid(float v, uint32_t steps) noexcept
+    {
+        return v > 0.0f ? (v < (float)steps ? v : (float)steps) : 0.0f;
+    }
+
+   /**
+      Coefficients at grid point @a i, @a j, computed on first use.
+    */
+    const float* point(uint32_t i, uint32_t j)
+    {
+        const uint32_t index = j * (fNoteSteps + 1) + i;
+        Point& p = fPoints[index];
+
+        if (! fValid[index])
+        {
+            const float note = kMinNote + (kMaxNote - kMinNote) * i / fNoteSteps;
+            const float res = kMinRes + (kMaxRes - kMinRes) * j / fResSteps;
+
+            fMaker.Reset();
+            fMaker.MakeCoeffs(note, res, fType, fSubType, nullptr, false);
+            std::memcpy(p.coeffs, fMaker.tC, sizeof(p.coeffs));
+            fValid[index] = 1;
+        }
+
+        return p.coeffs;
+    }
+};
+
+#endif  // #ifndef COEFF_CACHE_H
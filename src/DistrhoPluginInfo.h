@@ -12,17 +12,30 @@
  */
 #define DISTRHO_PLUGIN_NAME "ImGuiSimpleGain"
 
+/**
+   Number of audio channels the filter processes, between 1 and 64.@n
+   Channels are packed four at a time into the lanes of the sst quad filter states.
+   Set from CMake through the PLUGIN_NUM_CHANNELS cache variable.
+ */
+#ifndef PLUGIN_NUM_CHANNELS
+#define PLUGIN_NUM_CHANNELS 2
+#endif
+
+#if PLUGIN_NUM_CHANNELS < 1 || PLUGIN_NUM_CHANNELS > 64
+#error PLUGIN_NUM_CHANNELS must be between 1 and 64
+#endif
+
 /**
    Number of audio inputs the plugin has.
    @note This macro is required.
  */
-#define DISTRHO_PLUGIN_NUM_INPUTS 2
+#define DISTRHO_PLUGIN_NUM_INPUTS PLUGIN_NUM_CHANNELS
 
 /**
    Number of audio outputs the plugin has.
    @note This macro is required.
  */
-#define DISTRHO_PLUGIN_NUM_OUTPUTS 2
+#define DISTRHO_PLUGIN_NUM_OUTPUTS PLUGIN_NUM_CHANNELS
 
 /**
    The plugin URI when exporting in LV2 format.
@@ -62,13 +75,13 @@
    Whether the plugin introduces latency during audio or midi processing.
    @see Plugin::setLatency(uint32_t)
  */
-#define DISTRHO_PLUGIN_WANT_LATENCY 0
+#define DISTRHO_PLUGIN_WANT_LATENCY 1
 
 /**
    Whether the plugin wants MIDI input.@n
    This is automatically enabled if @ref DISTRHO_PLUGIN_IS_SYNTH is true.
  */
-#define DISTRHO_PLUGIN_WANT_MIDI_INPUT 0
+#define DISTRHO_PLUGIN_WANT_MIDI_INPUT 1
 
 /**
    Whether the plugin wants MIDI output.
@@ -156,7 +169,7 @@
 
    When this macro is defined, the companion DISTRHO_UI_DEFAULT_WIDTH macro must be defined as well.
  */
-#define DISTRHO_UI_DEFAULT_HEIGHT 400
+#define DISTRHO_UI_DEFAULT_HEIGHT 640
 
 /**
    Whether the %UI uses NanoVG for drawing instead of the default raw OpenGL calls.@n
@@ -267,7 +280,13 @@
       - Mono
       - Stereo
  */
+#if PLUGIN_NUM_CHANNELS == 1
+#define DISTRHO_PLUGIN_VST3_CATEGORIES "Fx|Dynamics|Mono"
+#elif PLUGIN_NUM_CHANNELS == 2
 #define DISTRHO_PLUGIN_VST3_CATEGORIES "Fx|Dynamics|Stereo"
+#else
+#define DISTRHO_PLUGIN_VST3_CATEGORIES "Fx|Dynamics|Surround"
+#endif
 
 /**
    Custom CLAP features for the plugin.@n
@@ -325,7 +344,13 @@
       - surround
       - ambisonic
 */
+#if PLUGIN_NUM_CHANNELS == 1
+#define DISTRHO_PLUGIN_CLAP_FEATURES "audio-effect", "mono"
+#elif PLUGIN_NUM_CHANNELS == 2
 #define DISTRHO_PLUGIN_CLAP_FEATURES "audio-effect", "stereo"
+#else
+#define DISTRHO_PLUGIN_CLAP_FEATURES "audio-effect", "surround"
+#endif
 
 /**
    The plugin id when exporting in CLAP format, in reverse URI form.
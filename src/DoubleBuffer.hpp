@@ -0,0 +1,59 @@
+/**
+ * Lock-free double buffer passing the latest value from one writer thread to one reader thread.
+ *
+ * The writer fills the buffer the reader is not looking at and publishes it by bumping a sequence number.
+ * The reader copies the published buffer and checks the sequence afterwards: if the writer has published again in
+ * the meantime it may have started on the buffer being copied, so the copy is dropped and the reader simply keeps
+ * its previous value until its next attempt. Neither side ever waits, which makes the reader safe on the audio thread.
+ */
+
+#ifndef DOUBLE_BUFFER_H
+#define DOUBLE_BUFFER_H
+
+#include <atomic>
+#include <stdint.h>
+#include <type_traits>
+
+template <typename T>
+class DoubleBuffer {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "DoubleBuffer values are copied while the writer may run");
+
+   /**
+      Publish @a value, only from the writer thread.
+    */
+    void publish(const T& value) noexcept
+    {
+        const uint32_t seq = fSeq.load(std::memory_order_relaxed);
+        fBuffers[(seq + 1) & 1] = value;
+        fSeq.store(seq + 1, std::memory_order_release);
+    }
+
+   /**
+      Copy the latest published value to @a value if it is newer than @a seq, and update @a seq, only from the reader
+      thread. @a seq starts at 0, before anything was published.@n
+      Returns false if there is nothing new, or if the writer got in the way and the reader should try again later.
+    */
+    bool read(T& value, uint32_t& seq) const noexcept
+    {
+        const uint32_t published = fSeq.load(std::memory_order_acquire);
+        if (published == seq)
+            return false;
+
+        const T copy = fBuffers[published & 1];
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (fSeq.load(std::memory_order_relaxed) != published)
+            return false;
+
+        value = copy;
+        seq = published;
+        return true;
+    }
+
+private:
+    T fBuffers[2]{};
+    std::atomic<uint32_t> fSeq = { 0 };
+};
+
+#endif  // #ifndef DOUBLE_BUFFER_H
@@ -0,0 +1,2168 @@
+/**
+ * DSP engine of the plugin, free of any host or DPF dependency.
+ *
+ * ImGuiPluginDSP forwards its parameters, activation and run() straight to this class,
+ * which lets the offline benchmarks drive exactly the same processing without a host.
+ * NumChannels planar channels are packed four at a time into the lanes of sst quad filter states.
+ * A channel whose input and filter have been silent for a while has its lane marked inactive, and quad states whose
+ * lanes are all inactive are skipped until signal comes back to one of them.
+ * A second filter stage with its own type, frequency and resonance can run after, beside or in a feedback loop with
+ * the first one, through the same block kernels. A drive stage can saturate or fold the signal on its way into the
+ * first stage or between the two.
+ */
+
+#ifndef FILTER_ENGINE_H
+#define FILTER_ENGINE_H
+
+#include "CoeffCache.hpp"
+#include "DoubleBuffer.hpp"
+#include "FilterKernels.hpp"
+#include "LaneOps.hpp"
+#include "Oversampler.hpp"
+#include "ScopedDenormals.hpp"
+#include "SmootherBank.hpp"
+#include "VoiceBank.hpp"
+#include "Waveshaper.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+
+#include <sst/filters.h>
+
+// --------------------------------------------------------------------------------------------------------------------
+
+#ifndef MIN
+#define MIN(a,b) ( (a) < (b) ? (a) : (b) )
+#endif
+
+#ifndef MAX
+#define MAX(a,b) ( (a) > (b) ? (a) : (b) )
+#endif
+
+#ifndef CLAMP
+#define CLAMP(v, min, max) (MIN((max), MAX((min), (v))))
+#endif
+
+/**
+   10^(dB / 20) without powf: 2^n from the exponent bits times a degree 5 series of 2^f for the rest, |f| <= 1/2.@n
+   Relative error stays below 4e-6, about 0.00004 dB, for the exponents of normal floats.
+ */
+static inline float fastDbToLinear(float dB)
+{
+    const float x = dB * 0.166096404744368f; // log2(10) / 20
+    const float n = std::floor(x + 0.5f);
+    const float f = x - n;
+
+    const float p = 1.0f + f * (0.693147181f + f * (0.240226507f + f * (0.0555041087f
+                                   + f * (0.00961812911f + f * 0.00133335581f))));
+
+    const int32_t bits = ((int32_t)n + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+#ifndef DB_CO
+#define DB_CO(g) ((g) > -90.0f ? fastDbToLinear(g) : 0.0f)
+#endif
+
+// default number of frames between two coefficient updates, a power of two between 4 and 64
+#ifndef PLUGIN_CONTROL_BLOCK_SIZE
+#define PLUGIN_CONTROL_BLOCK_SIZE 16
+#endif
+
+// default memory budget of the coefficient lookup caches together, in KiB, 0 to compute every update
+#ifndef PLUGIN_COEFF_CACHE_KB
+#define PLUGIN_COEFF_CACHE_KB 256
+#endif
+
+// 1 to have the plugin compute filter coefficients on a worker thread, see FilterEngine::setBackgroundCoeffs()
+#ifndef PLUGIN_BACKGROUND_COEFFS
+#define PLUGIN_BACKGROUND_COEFFS 1
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+
+template <uint32_t NumChannels>
+class FilterEngine
+{
+public:
+    // channels are packed four at a time into the lanes of a quad filter state
+    static constexpr uint32_t kNumChannels = NumChannels;
+    static constexpr uint32_t kNumGroups = (kNumChannels + 3) / 4;
+    static constexpr uint32_t kNumLanes = kNumGroups * 4;
+    // groups the stereo routing runs per stage, each one only filters the left or the right channels, packed together
+    static constexpr uint32_t kNumStereoGroups = ((kNumChannels + 1) / 2 + 3) / 4;
+
+    // host buffers are processed in control sub-blocks of up to this many frames
+    static constexpr uint32_t kChunkFrames = 64;
+
+    static_assert(kNumChannels >= 1 && kNumChannels <= 64, "FilterEngine handles 1 to 64 channels");
+    static_assert(PLUGIN_CONTROL_BLOCK_SIZE >= 4 && PLUGIN_CONTROL_BLOCK_SIZE <= kChunkFrames &&
+                  (PLUGIN_CONTROL_BLOCK_SIZE & (PLUGIN_CONTROL_BLOCK_SIZE - 1)) == 0,
+                  "PLUGIN_CONTROL_BLOCK_SIZE must be a power of two between 4 and 64");
+
+    // highest value of the Subtype parameter, clamped per type to the subtypes sst provides
+    static constexpr int kMaxSubTypeParam = 15;
+
+    // quality tiers, each one trades CPU for alias rejection and coefficient accuracy, see kQualityTiers
+    enum Quality {
+        kQualityEco = 0,
+        kQualityNormal,
+        kQualityHigh,
+        kQualityCount
+    };
+
+    // filter stages, the second one only runs with a routing other than kRoutingSingle
+    static constexpr uint32_t kNumStages = 2;
+
+    // how the second stage runs alongside the first one, see setRouting()
+    enum Routing {
+        kRoutingSingle = 0,
+        kRoutingSerial,
+        kRoutingParallel,
+        kRoutingStereo,
+        kRoutingFeedback,
+        kRoutingCount
+    };
+
+    // where the drive stage sits, see setDrivePosition()
+    enum DrivePosition {
+        kDrivePre = 0,
+        kDriveBetween,
+        kDrivePositionCount
+    };
+
+    // shapes of the drive stage, the first one bypasses it
+    static constexpr int kNumDriveShapes = Waveshaper<kNumLanes>::kShapeCount;
+
+    FilterEngine()
+    {
+        // the cutoffs glide linearly in notes, their targets are set again on every process() call and an S-curve
+        // would restart from zero slope each time, lagging behind automation
+        fSmoothers.setShape(kSmoothGain, SmootherBank::kShapeOnePole, kSmoothingMs);
+        fSmoothers.setShape(kSmoothFreqNote, SmootherBank::kShapeLinear, kSmoothingMs);
+        fSmoothers.setShape(kSmoothResonance, SmootherBank::kShapeLinear, kSmoothingMs);
+        fSmoothers.setShape(kSmoothMix, SmootherBank::kShapeLinear, kSmoothingMs);
+        fSmoothers.setSampleRate(fSampleRate);
+        fStageSmoothers.setShape(kSmoothFreqNote2, SmootherBank::kShapeLinear, kSmoothingMs);
+        fStageSmoothers.setShape(kSmoothResonance2, SmootherBank::kShapeLinear, kSmoothingMs);
+        fStageSmoothers.setShape(kSmoothFeedback, SmootherBank::kShapeLinear, kSmoothingMs);
+        fStageSmoothers.setShape(kSmoothDrive, SmootherBank::kShapeOnePole, kSmoothingMs);
+        fStageSmoothers.setSampleRate(fSampleRate);
+        setCoeffCacheSize(PLUGIN_COEFF_CACHE_KB);
+        setupCoeffMakers();
+    }
+
+    ~FilterEngine()
+    {
+        setBackgroundCoeffs(false);
+    }
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // Parameters, they may be set from any thread
+
+    void setGainDB(float gainDB)
+    {
+        fGainLinear = DB_CO(CLAMP(gainDB, -90.0f, 30.0f));
+    }
+
+   /**
+      Balance between the input, 0, and the filtered signal, 1. The gain applies to both.
+    */
+    void setMix(float mix)
+    {
+        fMix = CLAMP(mix, 0.0f, 1.0f);
+    }
+
+   /**
+      Frequency, resonance, type and subtype of filter @a stage, 0 for the first stage and 1 for the second one.
+    */
+    void setFrequencyNote(float note, uint32_t stage = 0)
+    {
+        fStages[MIN(stage, kNumStages - 1)].freqNote = note;
+    }
+
+    void setResonance(float resonance, uint32_t stage = 0)
+    {
+        fStages[MIN(stage, kNumStages - 1)].resonance = resonance;
+    }
+
+    void setFilterType(int type, uint32_t stage = 0)
+    {
+        fStages[MIN(stage, kNumStages - 1)].type = CLAMP(type, 0, sst::filters::num_filter_types - 1);
+    }
+
+    void setFilterSubType(int subType, uint32_t stage = 0)
+    {
+        fStages[MIN(stage, kNumStages - 1)].subType = CLAMP(subType, 0, kMaxSubTypeParam);
+    }
+
+   /**
+      Select how the second stage runs, one of Routing. Serial filters the output of the first stage, parallel
+      averages both stages filtering the input, stereo sends even channels through the first stage and odd ones
+      through the second, and feedback runs them in series with the output of the second fed back into the first.@n
+      Takes effect at the start of the next process() call, the second stage starts from silence when it comes in.
+      The synth-filter mode only runs the first stage.
+    */
+    void setRouting(int routing)
+    {
+        fRouting = CLAMP(routing, 0, kRoutingCount - 1);
+    }
+
+   /**
+      How much of the output of the second stage goes back into the first one with the feedback routing, 0 to 1.
+      The feedback is soft clipped, so a resonant loop saturates instead of blowing up.
+    */
+    void setFeedback(float amount)
+    {
+        fFeedback = CLAMP(amount, 0.0f, 1.0f);
+    }
+
+   /**
+      Select the curve of the drive stage, one of Waveshaper::Shape, kShapeOff taking the stage out.@n
+      Takes effect at the start of the next process() call, a new shape starts from a clear state.
+    */
+    void setDriveShape(int shape)
+    {
+        fDriveShape = CLAMP(shape, 0, kNumDriveShapes - 1);
+    }
+
+   /**
+      Gain into the drive stage, from 0 to 36 dB.
+    */
+    void setDriveDB(float driveDB)
+    {
+        fDriveGain = DB_CO(CLAMP(driveDB, 0.0f, 36.0f));
+    }
+
+   /**
+      Put the drive stage in front of the first filter stage, kDrivePre, or after it, kDriveBetween.
+      Between sits on the way into the second stage with the serial and feedback routings, and on the path of the
+      first stage alone with the others. In the synth-filter mode the voices stand in for the first stage.
+    */
+    void setDrivePosition(int position)
+    {
+        fDrivePosition = CLAMP(position, 0, kDrivePositionCount - 1);
+    }
+
+   /**
+      Switch between filtering the input as an effect and the polyphonic synth-filter mode, where every MIDI note
+      starts a voice filtering the input at its own key-tracked cutoff. Takes effect at the start of the next process()
+      call, going back to the effect mode restarts its filter.
+    */
+    void setPolyMode(bool enabled)
+    {
+        fPolyMode = enabled;
+    }
+
+   /**
+      How much the cutoff of a voice follows its key, 0 to 1. At 1 the cutoff moves a semitone per semitone,
+      and the Frequency note parameter is the offset from the key, 0 putting it right on the note.
+    */
+    void setKeyTrack(float amount)
+    {
+        fKeyTrack = CLAMP(amount, 0.0f, 1.0f);
+    }
+
+   /**
+      How much resonance a voice gains from its velocity, 0 to 1, on top of the Resonance parameter.
+    */
+    void setVelocityToResonance(float amount)
+    {
+        fVelocityToRes = CLAMP(amount, 0.0f, 1.0f);
+    }
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // MIDI notes for the synth-filter mode, only from the thread calling process(), in between two calls
+
+    void noteOn(uint8_t key, uint8_t velocity)
+    {
+        if (velocity == 0)
+            fVoices.noteOff(key);
+        else
+            fVoices.noteOn(key, velocity / 127.0f);
+    }
+
+    void noteOff(uint8_t key)
+    {
+        fVoices.noteOff(key);
+    }
+
+    void allNotesOff()
+    {
+        fVoices.allNotesOff();
+    }
+
+   /**
+      Number of voices sounding in the synth-filter mode, held or releasing.
+    */
+    uint32_t getActiveVoices() const noexcept
+    {
+        return fVoices.getActiveVoices();
+    }
+
+   /**
+      Number of quad filter states the sounding voices are packed into, those the synth-filter mode runs.
+    */
+    uint32_t getActiveVoiceStates() const noexcept
+    {
+        return fVoices.getActiveGroups();
+    }
+
+   /**
+      Run the filters at 1, 2, 4 or 8 times the sample rate, or at the rate of the quality tier for 0.@n
+      Takes effect at the start of the next process() call and restarts the filters, so it is not click-free.
+    */
+    void setOversampling(uint32_t factor)
+    {
+        if (factor == 0 || factor == 1 || factor == 2 || factor == 4 || factor == 8)
+            fOversampling = factor;
+    }
+
+   /**
+      Select the quality tier, one of Quality.@n
+      Takes effect at the start of the next process() call, a change of oversampling factor restarts the filters.
+    */
+    void setQuality(int quality)
+    {
+        fQuality = CLAMP(quality, 0, kQualityCount - 1);
+    }
+
+   /**
+      Run @a steps tiers below the selected quality, for the load governor.@n
+      A step lowers the control rate and settle tolerance, and the oversampling factor when the lower tier has a lower
+      one. The filters at the new factor start beside the running ones and are crossfaded in, their output delayed so
+      the latency stays the one of the selected tier. The voices of the synth-filter mode only run at one rate, so
+      that mode changes the factor once no voice sounds. Takes effect at the start of the next process() call.
+    */
+    void setQualityReduction(int steps)
+    {
+        fQualityReduction = MAX(steps, 0);
+    }
+
+   /**
+      Allow skipping the filters while input and tail are silent, on by default.@n
+      Turning it off keeps the filters running through silence, which the benchmarks use to measure decays.
+    */
+    void setSleepEnabled(bool enabled)
+    {
+        fSleepEnabled = enabled;
+    }
+
+   /**
+      Tell the engine whether the host is rendering offline, which always runs the high quality tier.
+    */
+    void setOfflineRendering(bool offline)
+    {
+        fOffline = offline;
+    }
+
+   /**
+      Latency added by oversampling, in frames, the one of the factor of the selected quality tier or Oversampling
+      setting as of the last process() call. Filters running at a lower factor for the load governor are delayed to it.
+    */
+    uint32_t getLatency() const noexcept
+    {
+        return fLatency;
+    }
+
+   /**
+      Quality tier the last process() call ran at, one of Quality. This is the selected tier lowered by the quality
+      reduction, or a higher one while the filters still run at its oversampling factor.
+    */
+    int getActiveQuality() const noexcept
+    {
+        return MAX(fControlQuality, fFactorQuality);
+    }
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // Setup, only while deactivated
+
+   /**
+      Change the sample rate, the engine must be activated again afterwards.
+    */
+    void setSampleRate(double sampleRate)
+    {
+        fSampleRate = sampleRate;
+        fSmoothers.setSampleRate(sampleRate);
+        fStageSmoothers.setSampleRate(sampleRate);
+        resetFilterRegisters();
+        setupCoeffMakers();
+        dirtyCoeffs = true;
+    }
+
+   /**
+      Set the number of voices of the synth-filter mode, 1 to 16. Allocates, so only while deactivated.
+    */
+    void setPolyphony(uint32_t voices)
+    {
+        fVoices.setPolyphony(voices);
+    }
+
+   /**
+      Set the number of frames between two coefficient updates in the normal quality tier.@n
+      Must be a power of two between 4 and 64, the engine must be activated again afterwards.
+    */
+    void setControlBlockSize(uint32_t frames)
+    {
+        if (frames < 4 || frames > kChunkFrames || (frames & (frames - 1)) != 0)
+            return;
+
+        fControlBlockSize = frames;
+        dirtyCoeffs = true;
+    }
+
+   /**
+      Set the memory budget of the coefficient lookup cache in KiB. It is split evenly between the grids of the two
+      slots of each stage and the one of the voices, so each gets a fifth of it, and the worker thread of
+      setBackgroundCoeffs() gets another grid of that size per stage.@n
+      0 computes the coefficients for every update instead. Allocates, so only while deactivated.
+    */
+    void setCoeffCacheSize(uint32_t kilobytes)
+    {
+        const uint32_t bytes = kilobytes * 1024 / (kNumStages * 2 + 1);
+
+        for (FilterStage& stage : fStages)
+        {
+            for (FilterSlot& slot : stage.slots)
+                slot.coeffCache.setBudget(bytes);
+        }
+        fVoiceCoeffCache.setBudget(bytes);
+        fWorkerCacheBytes = bytes;
+    }
+
+   /**
+      Compute filter coefficients on a worker thread while the smoothed frequency and resonance move.@n
+      When process() needs coefficients for control values the worker has not computed, it computes them itself and
+      hands the worker a copy of its smoothers, which the worker runs ahead to compute the coefficients of the
+      sub-blocks to come. process() glides towards the set computed for the control values closest to its own, even a
+      sub-block old under automation, so MakeCoeffs only runs on the audio thread before the worker first delivers and
+      when the parameters come to rest somewhere it has not computed. The output then depends slightly on when the
+      worker delivers, which is why it is ignored while rendering offline.
+      Starts or stops the thread, so only while deactivated.
+    */
+    void setBackgroundCoeffs(bool enabled)
+    {
+        if (enabled == fCoeffThread.joinable())
+            return;
+
+        if (enabled)
+        {
+            fCoeffThreadRunning = true;
+            fCoeffRequest = true;
+            fCoeffThread = std::thread([this] { runCoeffThread(); });
+        }
+        else
+        {
+            {
+                const std::lock_guard<std::mutex> lock(fCoeffMutex);
+                fCoeffThreadRunning = false;
+            }
+            fCoeffWake.notify_one();
+            fCoeffThread.join();
+        }
+
+        fBackgroundCoeffs = enabled;
+    }
+
+   /**
+      Bytes taken by the coefficient lookup cache.
+    */
+    uint32_t getCoeffCacheSize() const noexcept
+    {
+        uint32_t size = fVoiceCoeffCache.getSize();
+        for (const FilterStage& stage : fStages)
+            size += stage.slots[0].coeffCache.getSize() + stage.slots[1].coeffCache.getSize();
+        return size;
+    }
+
+   /**
+      Reset all filter state and start from the current parameters.
+    */
+    void activate()
+    {
+        // the gain fades in from silence, frequency and resonance start where the parameters are
+        setSmootherTargets();
+        fSmoothers.snap();
+        fSmoothers.reset(kSmoothGain, 0.0f);
+        fStageSmoothers.snap();
+        for (FilterStage& stage : fStages)
+        {
+            stage.ctrlFreqNote = stage.freqNote;
+            stage.ctrlResonance = stage.resonance;
+        }
+
+        applyQuality();
+        fRateFadeFramesLeft = 0;
+        resetPath(fPaths[fPath], fRunFactor);
+        fFactorQuality = fControlQuality;
+        setupCoeffMakers();
+        std::memset(dryWork, 0, sizeof(dryWork));
+        fVoices.reset();
+        fPolyActive = fPolyMode;
+        fRoutingActive = fRouting;
+
+        for (FilterStage& stage : fStages)
+        {
+            stage.activeSlot = 0;
+            restartStage(stage);
+        }
+
+        fSleeping = false;
+        fSilentFrames = 0;
+
+        dirtyCoeffs = false;
+    }
+
+   /**
+      Whether the last process() call skipped the filters because input and tail were silent.
+    */
+    bool isSleeping() const noexcept
+    {
+        return fSleeping;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // Processing
+
+   /**
+      Filter @a frames frames of planar audio, @a inputs and @a outputs may alias.
+    */
+    void process(const float* const* inputs, float* const* outputs, uint32_t frames)
+    {
+        const ScopedDenormals denormals;
+
+        // silent input into filters that have rung out only gives silence, nothing needs to run until signal returns
+        const bool inputSilent = inputIsSilent(inputs, frames);
+
+        if (inputSilent && fSleeping)
+        {
+            for (uint32_t c = 0; c < kNumChannels; ++c)
+                std::memset(outputs[c], 0, sizeof(float) * frames);
+
+            // nothing is heard while asleep, so waking up starts right at the current parameters, and released voices
+            // would only fade out unheard
+            setSmootherTargets();
+            fSmoothers.snap();
+            fStageSmoothers.snap();
+            if (fPolyActive)
+                fVoices.freeReleasedVoices();
+            return;
+        }
+
+        fSleeping = false;
+        float outputPeak = 0.0f;
+
+        // a request the worker thread could not be woken for when it was made
+        if (fCoeffWakePending)
+            wakeCoeffThread();
+
+        // another latency comes with another oversampling factor for the selected tier, the filters start over at the
+        // factor to run from the current parameters
+        if (applyQuality())
+        {
+            fRateFadeFramesLeft = 0;
+            resetPath(fPaths[fPath], fRunFactor);
+            fFactorQuality = fControlQuality;
+            setupCoeffMakers();
+            for (FilterStage& stage : fStages)
+                restartStage(stage);
+            std::memset(dryWork, 0, sizeof(dryWork));
+        }
+
+        const uint32_t blockSize = fTierControlBlockSize;
+        const uint32_t latency = fLatency;
+
+        // the filters of the effect mode sat idle while the voices played, they start over when coming back to them,
+        // and the voices only run at the factor of the running path
+        if (fPolyActive != fPolyMode)
+        {
+            fPolyActive = fPolyMode;
+            if (fPolyActive)
+            {
+                fRateFadeFramesLeft = 0;
+            }
+            else
+            {
+                for (FilterStage& stage : fStages)
+                    restartStage(stage);
+            }
+        }
+
+        // the second stage kept its registers from whenever it last ran, it starts over with the new routing, right
+        // at its parameters since its smoothers only run along with it
+        if (fRoutingActive != fRouting)
+        {
+            const bool wasStereo = fRoutingActive == kRoutingStereo;
+            fRoutingActive = fRouting;
+            if (wasStereo != (fRoutingActive == kRoutingStereo))
+                repackFirstStage(wasStereo);
+            if (fRoutingActive != kRoutingSingle)
+            {
+                snapStageSmoother(kSmoothFreqNote2);
+                snapStageSmoother(kSmoothResonance2);
+                snapStageSmoother(kSmoothFeedback);
+                fStages[1].ctrlFreqNote = fStages[1].freqNote;
+                fStages[1].ctrlResonance = fStages[1].resonance;
+                restartStage(fStages[1]);
+                if (fRateFadeFramesLeft != 0)
+                    setupSlot(fStages[1], fStages[1].slots[1 - fStages[1].activeSlot],
+                              fPaths[1 - fPath].oversampler.getFactor());
+            }
+        }
+
+        // the same for the drive gain, when the drive stage comes in
+        if (fPaths[fPath].shaper.getShape() != fDriveShape)
+        {
+            if (fPaths[fPath].shaper.getShape() == Waveshaper<kNumLanes>::kShapeOff)
+                snapStageSmoother(kSmoothDrive);
+            for (RatePath& path : fPaths)
+                path.shaper.setShape(fDriveShape);
+        }
+
+        // the voices change type on the spot, a new type or subtype of an effect stage starts in its idle slot and
+        // fades in over the old one
+        if (fPolyActive)
+        {
+            const int type = fStages[0].type;
+            const int subType = MIN(fStages[0].subType.load(), FilterKernels::numSubTypes(type) - 1);
+            fVoices.setFilter(sst::filters::FilterType(type), sst::filters::FilterSubType(subType));
+        }
+        else
+        {
+            for (uint32_t s = 0; s < getRunningStages(); ++s)
+            {
+                FilterStage& stage = fStages[s];
+                if (otherSlotRuns(stage) || ! slotIsStale(stage, stage.slots[stage.activeSlot]))
+                    continue;
+
+                setupSlot(stage, stage.slots[1 - stage.activeSlot], runningFactor());
+                stage.fadeFrames = stage.fadeFramesLeft = MAX(1u, (uint32_t)(kCrossfadeMs * 0.001 * fSampleRate));
+            }
+        }
+
+        followRunFactor();
+
+        setSmootherTargets();
+        std::memset(fLoudLanes, 0, sizeof(fLoudLanes));
+
+        for (uint32_t offset = 0; offset < frames; offset += blockSize)
+        {
+            const uint32_t chunk = MIN(blockSize, frames - offset);
+
+            // the coefficients glide across the sub-block towards the smoothed values at its end
+            fSmoothers.process(smoothed, chunk);
+            if (getRunningStages() > 1 || fPaths[fPath].shaper.getShape() != Waveshaper<kNumLanes>::kShapeOff)
+                fStageSmoothers.process(stageSmoothed, chunk);
+            updateCoefficients(&smoothed[(chunk - 1) * SmootherBank::kNumLanes],
+                               &stageSmoothed[(chunk - 1) * SmootherBank::kNumLanes]);
+
+            // the whole chunk is read before anything is written, so the host may alias inputs and outputs
+            readChunk(inputs, offset, chunk);
+            if (! fPolyActive)
+                markLoudLanes(chunk);
+
+            // the dry signal is delayed by the oversampling latency to line up with the filtered one
+            float* const dry = dryWork + latency * kNumLanes;
+            std::memcpy(dry, work, sizeof(float) * chunk * kNumLanes);
+
+            // while a governor step fades to another oversampling factor, the path running at it filters a copy of
+            // the input and is faded in over the running one
+            if (fRateFadeFramesLeft != 0)
+                std::memcpy(rateWork, work, sizeof(float) * chunk * kNumLanes);
+
+            runPath(fPaths[fPath], 0, work, chunk);
+
+            if (fRateFadeFramesLeft != 0)
+            {
+                runPath(fPaths[1 - fPath], 1, rateWork, chunk);
+
+                const uint32_t fadeDone = fRateFadeFrames - fRateFadeFramesLeft;
+                for (uint32_t i = 0; i < chunk; ++i)
+                    fadeRamp[i] = MIN(1.0f, (float)(fadeDone + i + 1) / (float)fRateFadeFrames);
+                laneOps.crossfadeRows(work, rateWork, fadeRamp, chunk, kNumLanes);
+                advanceRateFade(chunk);
+            }
+
+            laneOps.gainMixRows(work, dryWork, &smoothed[kSmoothGain], &smoothed[kSmoothMix], SmootherBank::kNumLanes,
+                                chunk, kNumLanes);
+            if (latency != 0)
+                std::memmove(dryWork, dryWork + chunk * kNumLanes, sizeof(float) * latency * kNumLanes);
+
+            if (inputSilent)
+                outputPeak = MAX(outputPeak, laneOps.peakRows(work, chunk, kNumLanes));
+            if (! fPolyActive)
+                markLoudLanes(chunk);
+
+            writeChunk(outputs, offset, chunk);
+        }
+
+        bool filtersDecayed;
+        if (fPolyActive)
+        {
+            fVoices.flushQuietLanes(kFlushEnergy);
+            filtersDecayed = fVoices.registersDecayed(kSilenceLevel);
+        }
+        else
+        {
+            filtersDecayed = true;
+            for (uint32_t s = 0; s < getRunningStages(); ++s)
+            {
+                FilterStage& stage = fStages[s];
+                flushQuietLanes(stage.slots[stage.activeSlot]);
+                if (otherSlotRuns(stage))
+                    flushQuietLanes(stage.slots[1 - stage.activeSlot]);
+                if (otherSlotRuns(stage) || ! registersDecayed(stage.slots[stage.activeSlot]))
+                    filtersDecayed = false;
+            }
+            updateIdleLanes(frames);
+        }
+
+        // the output has to stay silent for as long as the longest delay line, or signal may still come back out of it
+        if (inputSilent && outputPeak < kSilenceLevel && filtersDecayed)
+        {
+            fSilentFrames += frames;
+            if (fSilentFrames >= kSleepFrames + fLatency)
+                fSleeping = fSleepEnabled;
+        }
+        else
+        {
+            fSilentFrames = 0;
+        }
+    }
+
+private:
+    // length of the crossfade between the old and the new filter after a type or subtype change
+    static constexpr float kCrossfadeMs = 10.0f;
+
+    // input, output and filter registers below this level count as silent, about -120 dB
+    static constexpr float kSilenceLevel = 1e-6f;
+
+    // frames of silent output before sleeping, enough for the comb delay lines to have run empty
+    static constexpr uint32_t kSleepFrames = FilterKernels::kDelayLineSize;
+
+    // lanes whose registers hold less energy than this are cleared, far below hearing but above the denormal range
+    static constexpr float kFlushEnergy = 1e-24f;
+
+   /**
+      What a quality tier changes.@n
+      The control block is the normal one shifted by @a controlBlockShift, a positive shift makes it longer.
+      MakeCoeffs keeps running until its target moves by less than @a settleTolerance, relative to the coefficient.
+    */
+    struct QualityTier {
+        uint32_t oversampling;
+        int controlBlockShift;
+        float settleTolerance;
+    };
+
+    static constexpr QualityTier kQualityTiers[kQualityCount] = {
+        { 1,  2, 1e-5f }, // eco
+        { 1,  0, 1e-7f }, // normal
+        { 4, -2, 1e-8f }, // high
+    };
+
+    // lanes of the smoother bank, and how long each parameter takes to reach a new value
+    enum SmoothedParams {
+        kSmoothGain = 0,
+        kSmoothFreqNote,
+        kSmoothResonance,
+        kSmoothMix
+    };
+
+    // lanes of the second smoother bank, for the parameters only the second stage and the drive stage use
+    enum StageSmoothedParams {
+        kSmoothFreqNote2 = 0,
+        kSmoothResonance2,
+        kSmoothFeedback,
+        kSmoothDrive
+    };
+
+    static constexpr float kSmoothingMs = 20.0f;
+
+    double fSampleRate = 44100.0;
+    float fGainLinear = 1.0f;
+    float fMix = 1.0f;
+    float fFeedback = 0.0f;
+    float fDriveGain = 1.0f;
+    int fDriveShape = Waveshaper<kNumLanes>::kShapeOff;
+    int fDrivePosition = kDrivePre;
+
+    // routing as requested and as process() runs it
+    int fRouting = kRoutingSingle;
+    int fRoutingActive = kRoutingSingle;
+
+    // requested quality tier, the host rendering offline overrides it with the high one
+    int fQuality = kQualityNormal;
+    // tiers processing runs below fQuality, while the CPU budget is exceeded
+    int fQualityReduction = 0;
+    bool fOffline = false;
+    // tier the control rate and settle tolerance follow, and the one whose oversampling factor the filters run at
+    int fControlQuality = kQualityNormal;
+    int fFactorQuality = kQualityNormal;
+
+    // gain, frequency, resonance and mix smoothed side by side, and a sub-block of their values, one row per frame
+    SmootherBank fSmoothers;
+    float smoothed alignas(16)[kChunkFrames * SmootherBank::kNumLanes];
+    SmootherBank fStageSmoothers;
+    float stageSmoothed alignas(16)[kChunkFrames * SmootherBank::kNumLanes];
+
+    // control values the coefficients are computed from, the smoothed parameters at the end of each sub-block
+    // fControlBlockSize is the one of the normal tier, fTierControlBlockSize the one in use
+    uint32_t fControlBlockSize = PLUGIN_CONTROL_BLOCK_SIZE;
+    uint32_t fTierControlBlockSize = PLUGIN_CONTROL_BLOCK_SIZE;
+    float fSettleTolerance = 1e-7f;
+
+   /**
+      Everything one filter type needs: its unit, coefficients and the state of every quad group.@n
+      There are two of these so that a type change can run the old and the new filter side by side.
+    */
+    struct FilterSlot {
+        sst::filters::FilterType type = sst::filters::fut_none;
+        sst::filters::FilterSubType subType = sst::filters::FilterSubType(0);
+        sst::filters::FilterUnitQFPtr unit = nullptr;
+        FilterBlockKernel kernel = filterBlockKernelGeneric;
+
+        // oversampling factor the slot was set up for, and the rate it runs at
+        uint32_t factor = 1;
+        float rate = 44100.0f;
+
+        sst::filters::FilterCoefficientMaker<> coeffMaker;
+        CoeffCache coeffCache;
+        sst::filters::QuadFilterUnitState state[kNumGroups]{};
+
+        // coefficients are still gliding towards their target and MakeCoeffs keeps running until they settle
+        bool coeffsSettling = false;
+        // coefficients settled during the last sub-block, their per-sample ramp must be stopped
+        bool coeffsNeedFreeze = false;
+
+        float delayBuffer[kNumLanes][FilterKernels::kDelayLineSize];
+    };
+
+    // sub-blocks the worker thread computes coefficients for ahead of the audio thread
+    static constexpr uint32_t kCoeffAheadBlocks = 16;
+
+    // what the worker thread needs to follow the smoothed frequency and resonance of a stage, the smoothers as they
+    // stand after the current sub-block, the lanes to read and the filter to compute for
+    struct CoeffRequest {
+        SmootherBank smoothers;
+        uint32_t noteLane;
+        uint32_t resLane;
+        uint32_t blockSize;
+        sst::filters::FilterType type;
+        sst::filters::FilterSubType subType;
+        float rate;
+    };
+
+    // target coefficients of one filter type and subtype at one rate for the control values of the coming
+    // sub-blocks, as the worker thread publishes them
+    struct CoeffSet {
+        sst::filters::FilterType type;
+        sst::filters::FilterSubType subType;
+        float rate;
+        uint32_t count;
+        float freqNote[kCoeffAheadBlocks];
+        float resonance[kCoeffAheadBlocks];
+        float coeffs[kCoeffAheadBlocks][sst::filters::n_cm_coeffs];
+    };
+
+   /**
+      One filter stage: its parameters, the control values its coefficients are computed from, and two slots to
+      crossfade between on a type change.
+    */
+    struct FilterStage {
+        // read by the worker thread as well, when computing coefficients in the background
+        std::atomic<float> freqNote = { 0.0f };
+        std::atomic<float> resonance = { 0.5f };
+        std::atomic<int> type = { sst::filters::fut_vintageladder };
+        std::atomic<int> subType = { 0 };
+
+        // the smoothed frequency and resonance at the end of the last sub-block, and how far they moved in it
+        float ctrlFreqNote = 0.0f;
+        float ctrlResonance = 0.5f;
+        float ctrlMove = 0.0f;
+
+        FilterSlot slots[2];
+        uint32_t activeSlot = 0;
+
+        // crossfade from the active slot to the other one, in frames
+        uint32_t fadeFrames = 0;
+        uint32_t fadeFramesLeft = 0;
+
+        // requests for the worker thread, the sets it published, the latest one picked up and its sequence number,
+        // 0 before the first
+        DoubleBuffer<CoeffRequest> coeffRequests;
+        DoubleBuffer<CoeffSet> coeffSets;
+        CoeffSet coeffSet{};
+        uint32_t coeffSetSeq = 0;
+    };
+
+    FilterStage fStages[kNumStages];
+
+   /**
+      Everything around the filter stages that runs at one oversampling factor: the up/downsampler, the drive stage,
+      the last row of the feedback loop, and the delay lining the output up with the reported latency.@n
+      There are two of these so that a governor step can run the filters at the old and the new factor side by side
+      and crossfade between them, each path running one slot of every stage.
+    */
+    struct RatePath {
+        Oversampler<kNumLanes, kChunkFrames> oversampler;
+
+        // drive stage, running at the shape process() last saw
+        Waveshaper<kNumLanes> shaper;
+
+        // last output row of the second stage, fed back into the first one with the feedback routing
+        float feedbackRow alignas(16)[kNumLanes];
+
+        // the reported latency less the one of the oversampler, and the output rows waiting for it
+        uint32_t delay = 0;
+        float delayRows alignas(16)[(kChunkFrames + Oversampler<kNumLanes, kChunkFrames>::kMaxLatency) * kNumLanes];
+    };
+
+    // the path process() runs, and the other one only while a governor step fades to it
+    RatePath fPaths[2];
+    uint32_t fPath = 0;
+    uint32_t fRateFadeFrames = 0;
+    uint32_t fRateFadeFramesLeft = 0;
+    // quality tier whose factor the faded in path runs at
+    int fRateFadeQuality = kQualityNormal;
+
+    // latency of the factor of the selected tier, and the factor the filters should run at after the quality reduction
+    uint32_t fLatency = 0;
+    uint32_t fRunFactor = 1;
+
+    // set whenever frequency, resonance, type or sample rate changed and the coefficients need recomputing
+    std::atomic<bool> dirtyCoeffs = false;
+
+    // worker thread computing coefficients off the audio thread, see setBackgroundCoeffs()
+    bool fBackgroundCoeffs = false;
+    std::thread fCoeffThread;
+    std::mutex fCoeffMutex;
+    std::condition_variable fCoeffWake;
+    std::atomic<bool> fCoeffThreadRunning = { false };
+    std::atomic<bool> fCoeffRequest = { false };
+    std::atomic<bool> fCoeffWakePending = { false };
+    // budget of the worker's own lookup caches, the same as the one of every slot
+    std::atomic<uint32_t> fWorkerCacheBytes = { 0 };
+
+    // set once input and output have been silent for kSleepFrames with rung out registers, processing is skipped
+    bool fSleepEnabled = true;
+    bool fSleeping = false;
+    uint32_t fSilentFrames = 0;
+
+    // the same per channel lane of the effect mode: a bit per idle lane of every group, padding lanes always idle,
+    // frames each lane has been silent for, and the lanes with signal in or out during the current block
+    uint32_t fIdleLanes[kNumGroups];
+    uint32_t fLaneSilentFrames[kNumLanes];
+    uint32_t fLoudLanes[kNumGroups];
+
+    // synth-filter mode, as requested and as process() runs it, and the voices it plays
+    bool fPolyMode = false;
+    bool fPolyActive = false;
+    float fKeyTrack = 1.0f;
+    float fVelocityToRes = 0.0f;
+    VoiceBank<kNumChannels, kChunkFrames * Oversampler<kNumLanes, kChunkFrames>::kMaxFactor> fVoices;
+    CoeffCache fVoiceCoeffCache;
+
+    // requested oversampling factor, 0 to follow the quality tier
+    uint32_t fOversampling = 0;
+
+    // frame-major work buffers, one row of kNumLanes floats per frame
+    float work alignas(64)[kChunkFrames * kNumLanes];
+    // input and then output of the path faded in by a governor step
+    float rateWork alignas(64)[kChunkFrames * kNumLanes];
+    float fadeWork alignas(64)[kChunkFrames * Oversampler<kNumLanes, kChunkFrames>::kMaxFactor * kNumLanes];
+    // input of the second stage when it runs beside the first one
+    float stageWork alignas(64)[kChunkFrames * Oversampler<kNumLanes, kChunkFrames>::kMaxFactor * kNumLanes];
+    // input rows waiting for the filtered signal, the rows of the current chunk come after the latency ones
+    float dryWork alignas(64)[(kChunkFrames + Oversampler<kNumLanes, kChunkFrames>::kMaxLatency) * kNumLanes];
+    float fadeRamp alignas(16)[kChunkFrames * Oversampler<kNumLanes, kChunkFrames>::kMaxFactor];
+    // drive gain of every oversampled row of the chunk
+    float driveRamp alignas(16)[kChunkFrames * Oversampler<kNumLanes, kChunkFrames>::kMaxFactor];
+
+    // widest row operations supported by this CPU
+    const LaneOps& laneOps = LaneOps::best();
+
+    // ----------------------------------------------------------------------------------------------------------------
+
+    void resetSlotRegisters(FilterSlot& slot)
+    {
+        slot.coeffMaker.Reset();
+        for (uint32_t g = 0; g < kNumGroups; ++g)
+            FilterKernels::resetState(slot.state[g], &slot.delayBuffer[g * 4], kNumChannels - g * 4);
+    }
+
+    void resetFilterRegisters()
+    {
+        for (FilterStage& stage : fStages)
+        {
+            resetSlotRegisters(stage.slots[0]);
+            resetSlotRegisters(stage.slots[1]);
+        }
+        for (RatePath& path : fPaths)
+            std::memset(path.feedbackRow, 0, sizeof(path.feedbackRow));
+    }
+
+   /**
+      Tell the coefficient maker of @a slot the rate it runs at, and how many of its samples a sub-block has.
+    */
+    void setupCoeffMaker(FilterSlot& slot)
+    {
+        slot.rate = (float)(fSampleRate * slot.factor);
+        slot.coeffMaker.setSampleRateAndBlockSize(slot.rate, fTierControlBlockSize * slot.factor);
+    }
+
+   /**
+      Tell every coefficient maker, of every slot and of the voices, the rate it runs at and the sub-block size.
+    */
+    void setupCoeffMakers()
+    {
+        for (FilterStage& stage : fStages)
+        {
+            for (FilterSlot& slot : stage.slots)
+                setupCoeffMaker(slot);
+        }
+        const uint32_t factor = runningFactor();
+        fVoices.setRate((float)(fSampleRate * factor), fTierControlBlockSize * factor);
+    }
+
+   /**
+      Oversampling factor of the path process() runs.
+    */
+    uint32_t runningFactor() const noexcept
+    {
+        return fPaths[fPath].oversampler.getFactor();
+    }
+
+   /**
+      Start @a path over at @a factor from a clear state, with its output delayed up to the reported latency.
+    */
+    void resetPath(RatePath& path, uint32_t factor)
+    {
+        path.oversampler.setFactor(factor);
+        path.shaper.setShape(fDriveShape);
+        path.shaper.reset();
+        std::memset(path.feedbackRow, 0, sizeof(path.feedbackRow));
+        path.delay = fLatency - path.oversampler.getLatency();
+        std::memset(path.delayRows, 0, sizeof(path.delayRows));
+    }
+
+   /**
+      Move the filters to fRunFactor after a governor step changed it.@n
+      The effect mode sets the other path and the idle slot of every running stage up at the new factor, and fades to
+      them once no type crossfade is underway. The voices of the synth-filter mode only run at one rate, so that mode
+      keeps the factor it has until none of them sounds and then switches in place.
+    */
+    void followRunFactor()
+    {
+        if (fRateFadeFramesLeft != 0)
+            return;
+
+        if (fRunFactor == runningFactor())
+        {
+            fFactorQuality = fControlQuality;
+            return;
+        }
+
+        if (fPolyActive)
+        {
+            if (fVoices.getActiveVoices() != 0)
+                return;
+
+            resetPath(fPaths[fPath], fRunFactor);
+            fFactorQuality = fControlQuality;
+            setupCoeffMakers();
+            return;
+        }
+
+        for (uint32_t s = 0; s < getRunningStages(); ++s)
+        {
+            if (fStages[s].fadeFramesLeft != 0)
+                return;
+        }
+
+        resetPath(fPaths[1 - fPath], fRunFactor);
+        for (uint32_t s = 0; s < getRunningStages(); ++s)
+            setupSlot(fStages[s], fStages[s].slots[1 - fStages[s].activeSlot], fRunFactor);
+
+        fRateFadeQuality = fControlQuality;
+        fRateFadeFrames = fRateFadeFramesLeft = MAX(1u, (uint32_t)(kCrossfadeMs * 0.001 * fSampleRate));
+    }
+
+   /**
+      Move the crossfade to the other path on by a chunk of @a chunk frames, and make that path and the slots it ran
+      the running ones once it is done.
+    */
+    void advanceRateFade(uint32_t chunk)
+    {
+        fRateFadeFramesLeft -= MIN(chunk, fRateFadeFramesLeft);
+        if (fRateFadeFramesLeft != 0)
+            return;
+
+        fPath = 1 - fPath;
+        for (uint32_t s = 0; s < getRunningStages(); ++s)
+            fStages[s].activeSlot = 1 - fStages[s].activeSlot;
+        fFactorQuality = fRateFadeQuality;
+        setupCoeffMakers();
+    }
+
+   /**
+      Whether the idle slot of @a stage runs as well, faded in after a type change or by a governor step.
+    */
+    bool otherSlotRuns(const FilterStage& stage) const noexcept
+    {
+        return stage.fadeFramesLeft != 0 || fRateFadeFramesLeft != 0;
+    }
+
+   /**
+      Bring the latency, control block size and settle tolerance in line with the selected quality tier and the
+      quality reduction, and set fRunFactor to the oversampling factor the filters should run at.@n
+      The latency follows the factor of the selected tier, or the Oversampling setting, while the reduced tier sets the
+      rest. A new control block size only needs the coefficients recomputed, returns true if the latency changed and
+      the filters have to start over at fRunFactor.
+    */
+    bool applyQuality()
+    {
+        const int quality = fOffline ? kQualityHigh : fQuality;
+        fControlQuality = MAX(quality - (fOffline ? 0 : fQualityReduction), 0);
+
+        const QualityTier& controlTier = kQualityTiers[fControlQuality];
+        const uint32_t selectedFactor = fOversampling != 0 ? fOversampling : kQualityTiers[quality].oversampling;
+        fRunFactor = fOversampling != 0 ? fOversampling : controlTier.oversampling;
+
+        uint32_t blockSize = fControlBlockSize;
+        if (controlTier.controlBlockShift > 0)
+            blockSize = MIN(kChunkFrames, blockSize << controlTier.controlBlockShift);
+        else
+            blockSize = MAX(4u, blockSize >> -controlTier.controlBlockShift);
+
+        fSettleTolerance = controlTier.settleTolerance;
+
+        if (blockSize != fTierControlBlockSize)
+        {
+            fTierControlBlockSize = blockSize;
+            setupCoeffMakers();
+            dirtyCoeffs = true;
+        }
+
+        const uint32_t latency = Oversampler<kNumLanes, kChunkFrames>::latencyOf(selectedFactor);
+        if (latency == fLatency)
+            return false;
+
+        fLatency = latency;
+        dirtyCoeffs = true;
+        return true;
+    }
+
+   /**
+      Point @a slot of @a stage at the filter type and subtype currently selected by the parameters of the stage,
+      running at oversampling @a factor, starting from clear registers and with coefficients already at their target.
+    */
+    void setupSlot(FilterStage& stage, FilterSlot& slot, uint32_t factor)
+    {
+        const sst::filters::FilterType type = sst::filters::FilterType(stage.type.load());
+        const int subType = MIN(stage.subType.load(), FilterKernels::numSubTypes(type) - 1);
+
+        slot.type = type;
+        slot.subType = sst::filters::FilterSubType(subType);
+        slot.unit = sst::filters::GetQFPtrFilterUnit(slot.type, slot.subType);
+        slot.kernel = FilterKernels::get(slot.type, slot.subType);
+        slot.factor = factor;
+
+        resetSlotRegisters(slot);
+        setupCoeffMaker(slot);
+        makeSlotCoeffs(stage, slot);
+        for (uint32_t g = 0; g < kNumGroups; ++g)
+            slot.coeffMaker.updateState(slot.state[g]);
+
+        slot.coeffsSettling = false;
+        slot.coeffsNeedFreeze = false;
+
+        wakeAllLanes();
+    }
+
+   /**
+      Drop any crossfade of @a stage and start its active slot over from the current parameters.
+      The feedback loop runs through both stages, so it starts over from silence as well.
+    */
+    void restartStage(FilterStage& stage)
+    {
+        stage.fadeFramesLeft = 0;
+        setupSlot(stage, stage.slots[stage.activeSlot], runningFactor());
+        for (RatePath& path : fPaths)
+            std::memset(path.feedbackRow, 0, sizeof(path.feedbackRow));
+    }
+
+   /**
+      Number of stages the routing runs, the first one or both.
+    */
+    uint32_t getRunningStages() const noexcept
+    {
+        return fRoutingActive == kRoutingSingle ? 1 : kNumStages;
+    }
+
+   /**
+      Mark every channel lane of every slot active again, each has to go silent for kSleepFrames before it idles.
+    */
+    void wakeAllLanes()
+    {
+        for (uint32_t g = 0; g < kNumGroups; ++g)
+        {
+            fIdleLanes[g] = 0;
+            for (uint32_t k = 0; k < 4; ++k)
+            {
+                if (g * 4 + k >= kNumChannels)
+                    fIdleLanes[g] |= 1u << k;
+            }
+            setLanesActive(g, 0xF & ~fIdleLanes[g], true);
+            if (fIdleLanes[g] != 0)
+                setLanesActive(g, fIdleLanes[g], false);
+        }
+
+        std::memset(fLaneSilentFrames, 0, sizeof(fLaneSilentFrames));
+    }
+
+   /**
+      Set or clear the active[] flag of the lanes in @a mask of group @a g, in every slot. Lanes going idle are
+      cleared, so they pick up from silence when they wake.
+    */
+    void setLanesActive(uint32_t g, uint32_t mask, bool active)
+    {
+        for (uint32_t s = 0; s < kNumStages; ++s)
+        {
+            for (FilterSlot& slot : fStages[s].slots)
+            {
+                for (uint32_t k = 0; k < 4; ++k)
+                {
+                    uint32_t sg, sk;
+                    if ((mask & (1u << k)) == 0 || ! stateLane(s, g * 4 + k, sg, sk))
+                        continue;
+
+                    if (! active)
+                        FilterKernels::resetLane(slot.state[sg], sk);
+                    slot.state[sg].active[sk] = active ? 0xFFFFFFFF : 0;
+                }
+            }
+        }
+
+        if (! active)
+        {
+            for (uint32_t k = 0; k < 4; ++k)
+            {
+                if ((mask & (1u << k)) == 0)
+                    continue;
+                for (RatePath& path : fPaths)
+                    path.feedbackRow[g * 4 + k] = 0.0f;
+            }
+        }
+    }
+
+   /**
+      Add the lanes of the work buffer with a sample at or above kSilenceLevel in its @a frames frames to the loud
+      lanes of the block, and wake the idle ones among them.
+    */
+    void markLoudLanes(uint32_t frames)
+    {
+        const __m128 level = _mm_set1_ps(kSilenceLevel);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (uint32_t g = 0; g < kNumGroups; ++g)
+        {
+            // a lane heard once in the block cannot idle after it, padding lanes never can
+            const uint32_t channelLanes = kNumChannels - g * 4 >= 4 ? 0xFu : (1u << (kNumChannels - g * 4)) - 1;
+            if ((fLoudLanes[g] & channelLanes) == channelLanes)
+                continue;
+
+            __m128 loud = zero;
+            for (uint32_t i = 0; i < frames; ++i)
+            {
+                const __m128 x = _mm_load_ps(&work[i * kNumLanes + g * 4]);
+                loud = _mm_or_ps(loud, _mm_cmpge_ps(_mm_max_ps(x, _mm_sub_ps(zero, x)), level));
+            }
+
+            const uint32_t mask = (uint32_t)_mm_movemask_ps(loud);
+            fLoudLanes[g] |= mask;
+
+            const uint32_t waking = mask & fIdleLanes[g];
+            if (waking != 0)
+            {
+                fIdleLanes[g] &= ~waking;
+                setLanesActive(g, waking, true);
+            }
+        }
+    }
+
+   /**
+      Count the frames every lane has been silent for, in and out and in its registers, after a block of @a frames
+      frames, and idle the lanes that have been for as long as the whole engine waits before sleeping.
+    */
+    void updateIdleLanes(uint32_t frames)
+    {
+        const uint32_t idleAfter = kSleepFrames + fLatency;
+
+        for (uint32_t g = 0; g < kNumGroups; ++g)
+        {
+            uint32_t loud = fLoudLanes[g];
+            for (uint32_t s = 0; s < getRunningStages(); ++s)
+            {
+                const FilterStage& stage = fStages[s];
+                loud |= slotLoudLanes(s, stage.slots[stage.activeSlot], g);
+                if (otherSlotRuns(stage))
+                    loud |= slotLoudLanes(s, stage.slots[1 - stage.activeSlot], g);
+            }
+
+            uint32_t idling = 0;
+            for (uint32_t k = 0; k < 4; ++k)
+            {
+                const uint32_t lane = g * 4 + k;
+                if ((fIdleLanes[g] & (1u << k)) != 0)
+                    continue;
+
+                if ((loud & (1u << k)) != 0)
+                {
+                    fLaneSilentFrames[lane] = 0;
+                    continue;
+                }
+
+                fLaneSilentFrames[lane] += frames;
+                if (fSleepEnabled && fLaneSilentFrames[lane] >= idleAfter)
+                    idling |= 1u << k;
+            }
+
+            if (idling != 0)
+            {
+                fIdleLanes[g] |= idling;
+                setLanesActive(g, idling, false);
+            }
+        }
+    }
+
+   /**
+      Where the slot states of stage @a s run the channel lane @a lane, as lane @a k of group @a g.@n
+      The stereo routing packs the even lanes, the left channels, into the first groups of the first stage and the
+      odd ones into those of the second, so that each stage only filters the channels it outputs. Returns false if
+      stage @a s does not run @a lane.
+    */
+    bool stateLane(uint32_t s, uint32_t lane, uint32_t& g, uint32_t& k) const noexcept
+    {
+        uint32_t packed = lane;
+        if (fRoutingActive == kRoutingStereo)
+        {
+            if (lane % 2 != s)
+                return false;
+            packed = lane / 2;
+        }
+
+        g = packed / 4;
+        k = packed % 4;
+        return true;
+    }
+
+   /**
+      Number of groups of the slot states of a stage that run.
+    */
+    uint32_t getStateGroups() const noexcept
+    {
+        return fRoutingActive == kRoutingStereo ? kNumStereoGroups : kNumGroups;
+    }
+
+   /**
+      Idle lanes of group @a g of the slot states of stage @a s, a bit per lane like fIdleLanes.
+    */
+    uint32_t stateIdleLanes(uint32_t s, uint32_t g) const noexcept
+    {
+        if (fRoutingActive != kRoutingStereo)
+            return fIdleLanes[g];
+
+        uint32_t idle = 0;
+        for (uint32_t k = 0; k < 4; ++k)
+        {
+            const uint32_t lane = (g * 4 + k) * 2 + s;
+            if (lane >= kNumLanes || (fIdleLanes[lane / 4] & (1u << (lane % 4))) != 0)
+                idle |= 1u << k;
+        }
+        return idle;
+    }
+
+   /**
+      Channel lanes of group @a g with a register of @a slot of stage @a s at or above kSilenceLevel, a bit per lane.
+    */
+    uint32_t slotLoudLanes(uint32_t s, const FilterSlot& slot, uint32_t g) const
+    {
+        if (fRoutingActive != kRoutingStereo)
+            return (uint32_t)FilterKernels::loudLanes(slot.state[g], kSilenceLevel);
+
+        uint32_t loud = 0;
+        for (uint32_t k = 0; k < 4; ++k)
+        {
+            uint32_t sg, sk;
+            if (stateLane(s, g * 4 + k, sg, sk)
+                && (FilterKernels::loudLanes(slot.state[sg], kSilenceLevel) & (1 << sk)) != 0)
+                loud |= 1u << k;
+        }
+        return loud;
+    }
+
+   /**
+      Move the lanes of the first stage to where the routing now runs them, packed together after switching to the
+      stereo routing and spread back out after leaving it when @a wasStereo. The left channels carry on where they
+      were, the right ones the stereo routing left to the second stage start over from silence.
+    */
+    void repackFirstStage(bool wasStereo)
+    {
+        for (FilterSlot& slot : fStages[0].slots)
+        {
+            if (! wasStereo)
+            {
+                for (uint32_t lane = 1; lane < kNumLanes; lane += 2)
+                {
+                    FilterKernels::resetLane(slot.state[lane / 4], lane % 4);
+                    slot.state[lane / 4].active[lane % 4] = 0;
+                }
+                for (uint32_t p = 1; p * 2 < kNumLanes; ++p)
+                    FilterKernels::moveLane(slot.state[p * 2 / 4], p * 2 % 4, slot.state[p / 4], p % 4);
+            }
+            else
+            {
+                for (uint32_t p = (kNumLanes - 1) / 2; p > 0; --p)
+                    FilterKernels::moveLane(slot.state[p / 4], p % 4, slot.state[p * 2 / 4], p * 2 % 4);
+            }
+        }
+
+        for (uint32_t g = 0; g < kNumGroups; ++g)
+        {
+            setLanesActive(g, 0xF & ~fIdleLanes[g], true);
+            if (fIdleLanes[g] != 0)
+                setLanesActive(g, fIdleLanes[g], false);
+        }
+    }
+
+   /**
+      Whether the type or subtype parameters of @a stage ask for something else than what @a slot runs.
+    */
+    bool slotIsStale(const FilterStage& stage, const FilterSlot& slot) const
+    {
+        const int type = stage.type;
+        const int subType = MIN(stage.subType.load(), FilterKernels::numSubTypes(type) - 1);
+        return slot.type != type || slot.subType != subType;
+    }
+
+   /**
+      Point the smoothers at the current gain, frequency, resonance, mix, feedback and drive parameters.
+    */
+    void setSmootherTargets() noexcept
+    {
+        fSmoothers.setTarget(kSmoothGain, fGainLinear);
+        fSmoothers.setTarget(kSmoothFreqNote, fStages[0].freqNote);
+        fSmoothers.setTarget(kSmoothResonance, fStages[0].resonance);
+        fSmoothers.setTarget(kSmoothMix, fMix);
+        fStageSmoothers.setTarget(kSmoothFreqNote2, fStages[1].freqNote);
+        fStageSmoothers.setTarget(kSmoothResonance2, fStages[1].resonance);
+        fStageSmoothers.setTarget(kSmoothFeedback, fFeedback);
+        fStageSmoothers.setTarget(kSmoothDrive, fDriveGain);
+    }
+
+   /**
+      Jump @a lane of the second smoother bank right to its parameter, for a stage that has not been running.
+    */
+    void snapStageSmoother(uint32_t lane) noexcept
+    {
+        setSmootherTargets();
+        fStageSmoothers.reset(lane, fStageSmoothers.getTarget(lane));
+    }
+
+   /**
+      Run the coefficient maker of @a slot for the current control values of @a stage, from the lookup cache if it
+      has one and it covers the cutoff.
+    */
+    void makeSlotCoeffs(const FilterStage& stage, FilterSlot& slot)
+    {
+        if (! slot.coeffCache.isEnabled() || ! CoeffCache::covers(stage.ctrlFreqNote))
+        {
+            slot.coeffMaker.MakeCoeffs(stage.ctrlFreqNote, stage.ctrlResonance, slot.type, slot.subType, nullptr,
+                                       false);
+            return;
+        }
+
+        float coeffs[sst::filters::n_cm_coeffs];
+        slot.coeffCache.lookup(stage.ctrlFreqNote, stage.ctrlResonance, slot.type, slot.subType, slot.rate, coeffs);
+        slot.coeffMaker.FromDirect(coeffs);
+    }
+
+   /**
+      Glide the coefficients of @a slot towards the ones the worker thread published for the control values closest to
+      the current ones of @a stage, and set @a exact if they were computed for exactly these values.@n
+      Automation moves the targets of the smoothers the worker ran ahead with, so the latest set can be behind. A set
+      no further off than the control values moved over the last sub-block is taken all the same and the worker asked
+      to catch up, the slot keeps settling until it gets coefficients for its exact control values.
+      Returns false if @a slot has to compute its coefficients itself: the worker has published nothing for this filter
+      yet, or nothing close enough, which includes anything but the exact values once they came to rest.
+    */
+    bool usePublishedCoeffs(FilterStage& stage, FilterSlot& slot, bool& exact)
+    {
+        exact = false;
+        if (! backgroundCoeffsActive())
+            return false;
+
+        const CoeffSet& set = stage.coeffSet;
+        if (stage.coeffSetSeq == 0 || set.count == 0 || set.type != slot.type || set.subType != slot.subType
+            || set.rate != slot.rate)
+        {
+            requestCoeffs(stage, slot);
+            return false;
+        }
+
+        uint32_t nearest = 0;
+        float nearestDistance = INFINITY;
+        for (uint32_t b = 0; b < set.count; ++b)
+        {
+            const float distance = controlDistance(set.freqNote[b], set.resonance[b], stage.ctrlFreqNote,
+                                                   stage.ctrlResonance);
+            if (distance < nearestDistance)
+            {
+                nearest = b;
+                nearestDistance = distance;
+            }
+        }
+
+        exact = nearestDistance == 0.0f;
+        if (! exact)
+        {
+            requestCoeffs(stage, slot);
+            if (nearestDistance > stage.ctrlMove)
+                return false;
+        }
+
+        slot.coeffMaker.FromDirect(set.coeffs[nearest]);
+        return true;
+    }
+
+   /**
+      Distance between two pairs of cutoff note and resonance, the full range of the resonance counting as much as the
+      one of the cutoff.
+    */
+    static float controlDistance(float freqNote, float resonance, float otherFreqNote, float otherResonance) noexcept
+    {
+        return std::fabs(freqNote - otherFreqNote)
+             + std::fabs(resonance - otherResonance) * (CoeffCache::kMaxNote - CoeffCache::kMinNote);
+    }
+
+   /**
+      Whether process() takes coefficients from the worker thread, which it never does while rendering offline.
+    */
+    bool backgroundCoeffsActive() const noexcept
+    {
+        return fBackgroundCoeffs && ! fOffline;
+    }
+
+   /**
+      Ask the worker thread for the coefficients of @a slot over the sub-blocks after the current one, following the
+      smoothers @a stage takes its control values from.
+    */
+    void requestCoeffs(FilterStage& stage, const FilterSlot& slot) noexcept
+    {
+        const bool first = &stage == &fStages[0];
+        const CoeffRequest request = {
+            first ? fSmoothers : fStageSmoothers,
+            first ? (uint32_t)kSmoothFreqNote : (uint32_t)kSmoothFreqNote2,
+            first ? (uint32_t)kSmoothResonance : (uint32_t)kSmoothResonance2,
+            fTierControlBlockSize,
+            slot.type,
+            slot.subType,
+            slot.rate
+        };
+        stage.coeffRequests.publish(request);
+
+        fCoeffRequest = true;
+        wakeCoeffThread();
+    }
+
+   /**
+      Notify the worker thread of a request.@n
+      Passing through the mutex between setting the request and notifying is what keeps the notification from
+      arriving while the worker has checked for requests but is not waiting yet, and getting lost. The audio thread
+      must not block on the mutex though, so when the worker holds it the wake-up stays pending and the next
+      process() call tries again.
+    */
+    void wakeCoeffThread() noexcept
+    {
+        if (! fCoeffMutex.try_lock())
+        {
+            fCoeffWakePending = true;
+            return;
+        }
+
+        fCoeffWakePending = false;
+        fCoeffMutex.unlock();
+        fCoeffWake.notify_one();
+    }
+
+   /**
+      Worker thread, runs the smoothers of every stage with a new request ahead and publishes the coefficients of the
+      sub-blocks to come.@n
+      They are computed the way makeSlotCoeffs() would compute them, through a lookup cache with the same grid as the
+      ones of the slots when those are enabled, and otherwise with the first MakeCoeffs after a reset, which lands
+      right on the target that MakeCoeffs glides towards.
+    */
+    void runCoeffThread()
+    {
+        sst::filters::FilterCoefficientMaker<> coeffMaker;
+        CoeffCache caches[kNumStages];
+        uint32_t cacheBytes[kNumStages] = {};
+        uint32_t requestSeqs[kNumStages] = {};
+        CoeffRequest request;
+        CoeffSet set;
+        float rows alignas(16)[kChunkFrames * SmootherBank::kNumLanes];
+
+        std::unique_lock<std::mutex> lock(fCoeffMutex);
+
+        while (fCoeffThreadRunning)
+        {
+            // sleeps until requestCoeffs(), see wakeCoeffThread() for how no request gets missed
+            fCoeffWake.wait(lock, [this] { return fCoeffRequest || ! fCoeffThreadRunning; });
+
+            if (! fCoeffThreadRunning || ! fCoeffRequest.exchange(false))
+                continue;
+
+            lock.unlock();
+
+            for (uint32_t s = 0; s < kNumStages; ++s)
+            {
+                FilterStage& stage = fStages[s];
+                if (! stage.coeffRequests.read(request, requestSeqs[s]))
+                    continue;
+
+                // the budget is only set while deactivated, allocating here keeps that off the audio thread
+                if (cacheBytes[s] != fWorkerCacheBytes)
+                {
+                    cacheBytes[s] = fWorkerCacheBytes;
+                    caches[s].setBudget(cacheBytes[s]);
+                }
+
+                set.type = request.type;
+                set.subType = request.subType;
+                set.rate = request.rate;
+                set.count = 0;
+                coeffMaker.setSampleRateAndBlockSize(request.rate, 1);
+
+                for (uint32_t b = 0; b < kCoeffAheadBlocks; ++b)
+                {
+                    request.smoothers.process(rows, request.blockSize);
+                    const float* const controls = &rows[(request.blockSize - 1) * SmootherBank::kNumLanes];
+                    const float freqNote = controls[request.noteLane];
+                    const float resonance = controls[request.resLane];
+
+                    // once the smoothers arrive every sub-block after gets the same values
+                    if (b != 0 && freqNote == set.freqNote[b - 1] && resonance == set.resonance[b - 1])
+                        break;
+
+                    set.freqNote[b] = freqNote;
+                    set.resonance[b] = resonance;
+                    if (caches[s].isEnabled() && CoeffCache::covers(freqNote))
+                    {
+                        caches[s].lookup(freqNote, resonance, set.type, set.subType, set.rate, set.coeffs[b]);
+                    }
+                    else
+                    {
+                        coeffMaker.Reset();
+                        coeffMaker.MakeCoeffs(freqNote, resonance, set.type, set.subType, nullptr, false);
+                        std::memcpy(set.coeffs[b], coeffMaker.tC, sizeof(set.coeffs[b]));
+                    }
+                    ++set.count;
+                }
+
+                stage.coeffSets.publish(set);
+            }
+
+            lock.lock();
+        }
+    }
+
+   /**
+      Recompute the coefficients of @a slot of @a stage while they are settling, and stop their ramp once they
+      have.
+    */
+    void updateSlotCoefficients(FilterStage& stage, FilterSlot& slot)
+    {
+        sst::filters::FilterCoefficientMaker<>& coeffMaker = slot.coeffMaker;
+
+        if (slot.coeffsSettling)
+        {
+            // all groups share one set of coefficients, pick up where the last ramp left it
+            float prevTarget[sst::filters::n_cm_coeffs];
+            for (int f = 0; f < sst::filters::n_cm_coeffs; ++f)
+            {
+                coeffMaker.C[f] = slot.state[0].C[f][0];
+                prevTarget[f] = coeffMaker.tC[f];
+            }
+            bool exact = true;
+            if (! usePublishedCoeffs(stage, slot, exact))
+                makeSlotCoeffs(stage, slot);
+            for (uint32_t g = 0; g < kNumGroups; ++g)
+                coeffMaker.updateState(slot.state[g]);
+
+            // MakeCoeffs smooths its target geometrically, it has settled once the target stops moving, and a set the
+            // worker computed for other control values is never the target to settle on
+            bool settled = exact;
+            for (int f = 0; settled && f < sst::filters::n_cm_coeffs; ++f)
+            {
+                if (std::fabs(coeffMaker.tC[f] - prevTarget[f]) > fSettleTolerance * (1.0f + std::fabs(coeffMaker.tC[f])))
+                {
+                    settled = false;
+                    break;
+                }
+            }
+
+            if (settled)
+            {
+                slot.coeffsSettling = false;
+                slot.coeffsNeedFreeze = true;
+            }
+        }
+        else if (slot.coeffsNeedFreeze)
+        {
+            // land exactly on the target, otherwise the units keep adding dC every sample
+            for (uint32_t g = 0; g < kNumGroups; ++g)
+            {
+                for (int f = 0; f < sst::filters::n_cm_coeffs; ++f)
+                {
+                    slot.state[g].C[f] = _mm_set1_ps(coeffMaker.tC[f]);
+                    slot.state[g].dC[f] = _mm_setzero_ps();
+                }
+            }
+            slot.coeffsNeedFreeze = false;
+        }
+    }
+
+   /**
+      Take the smoothed frequency @a freqNote and resonance @a resonance as the control values of @a stage, and let
+      its slots settle again if they or @a dirty say something changed. Picks up the latest set from the worker thread.
+    */
+    void setStageControls(FilterStage& stage, float freqNote, float resonance, bool dirty)
+    {
+        bool changed = dirty;
+
+        if (backgroundCoeffsActive())
+            stage.coeffSets.read(stage.coeffSet, stage.coeffSetSeq);
+
+        stage.ctrlMove = controlDistance(freqNote, resonance, stage.ctrlFreqNote, stage.ctrlResonance);
+        if (freqNote != stage.ctrlFreqNote || resonance != stage.ctrlResonance)
+        {
+            stage.ctrlFreqNote = freqNote;
+            stage.ctrlResonance = resonance;
+            changed = true;
+        }
+
+        if (changed)
+        {
+            for (FilterSlot& slot : stage.slots)
+            {
+                slot.coeffsSettling = true;
+                slot.coeffsNeedFreeze = false;
+            }
+        }
+    }
+
+   /**
+      Bring the filter coefficients up to date at the start of a control sub-block, from the last rows of smoothed
+      parameters, @a controls of the main smoother bank and @a stageControls of the second stage one, which is only
+      read while the second stage runs.@n
+      MakeCoeffs only runs after a change, and keeps running every sub-block until the smoothed target has caught up,
+      after which the per-sample coefficient ramp is stopped and the coefficients are left alone.
+      While it runs, sst's dC slots interpolate the coefficients sample by sample across the sub-block.
+    */
+    void updateCoefficients(const float* controls, const float* stageControls)
+    {
+        const bool dirty = dirtyCoeffs.exchange(false);
+
+        setStageControls(fStages[0], controls[kSmoothFreqNote], controls[kSmoothResonance], dirty);
+        if (getRunningStages() > 1)
+            setStageControls(fStages[1], stageControls[kSmoothFreqNote2], stageControls[kSmoothResonance2], dirty);
+
+        if (fPolyActive)
+        {
+            fVoices.updateCoefficients(fStages[0].ctrlFreqNote, fStages[0].ctrlResonance, fKeyTrack, fVelocityToRes,
+                                       fSettleTolerance, fVoiceCoeffCache);
+            return;
+        }
+
+        for (uint32_t s = 0; s < getRunningStages(); ++s)
+        {
+            FilterStage& stage = fStages[s];
+            updateSlotCoefficients(stage, stage.slots[stage.activeSlot]);
+
+            if (otherSlotRuns(stage))
+                updateSlotCoefficients(stage, stage.slots[1 - stage.activeSlot]);
+        }
+    }
+
+   /**
+      Filter @a frames frames of @a buffer in place through the quad groups of @a slot of stage @a s that run, laid
+      out as stateLane() says.@n
+      Groups with every lane idle only get silence, their coefficients still ramp along with the others.
+    */
+    void runSlot(uint32_t s, FilterSlot& slot, float* buffer, uint32_t frames)
+    {
+        for (uint32_t g = 0; g < getStateGroups(); ++g)
+        {
+            if (stateIdleLanes(s, g) == 0xF)
+            {
+                FilterKernels::advanceCoefficients(slot.state[g], frames);
+                for (uint32_t i = 0; i < frames; ++i)
+                    _mm_store_ps(&buffer[i * kNumLanes + g * 4], _mm_setzero_ps());
+                continue;
+            }
+
+            slot.kernel(slot.unit, &slot.state[g], &buffer[g * 4], kNumLanes, frames);
+        }
+    }
+
+   /**
+      Filter @a frames rows of @a rows in place through @a stage, crossfading to its other slot if a type change is
+      underway. The rows start @a rowOffset rows into the current chunk.@n
+      @a side is the slot the rate path runs, 0 for the active one and 1 for the other one while a governor step fades
+      to it. The two crossfades never run at the same time.
+    */
+    void runStage(FilterStage& stage, uint32_t side, float* rows, uint32_t frames, uint32_t rowOffset)
+    {
+        FilterSlot& active = stage.slots[stage.activeSlot ^ side];
+        const uint32_t s = (uint32_t)(&stage - fStages);
+
+        if (stage.fadeFramesLeft == 0)
+        {
+            runSlot(s, active, rows, frames);
+            return;
+        }
+
+        std::memcpy(fadeWork, rows, sizeof(float) * frames * kNumLanes);
+        runSlot(s, active, rows, frames);
+        runSlot(s, stage.slots[1 - stage.activeSlot], fadeWork, frames);
+
+        const uint32_t factor = active.factor;
+        const uint32_t fadeDone = (stage.fadeFrames - stage.fadeFramesLeft) * factor + rowOffset;
+        const float fadeLength = (float)(stage.fadeFrames * factor);
+        for (uint32_t i = 0; i < frames; ++i)
+            fadeRamp[i] = MIN(1.0f, (float)(fadeDone + i + 1) / fadeLength);
+        laneOps.crossfadeRows(rows, fadeWork, fadeRamp, frames, kNumLanes);
+    }
+
+   /**
+      Move the crossfade of @a stage on by a chunk of @a chunk frames, and make the faded in slot the active one once
+      it is done.
+    */
+    void advanceFade(FilterStage& stage, uint32_t chunk)
+    {
+        if (stage.fadeFramesLeft == 0)
+            return;
+
+        stage.fadeFramesLeft -= MIN(chunk, stage.fadeFramesLeft);
+        if (stage.fadeFramesLeft == 0)
+            stage.activeSlot = 1 - stage.activeSlot;
+    }
+
+   /**
+      Filter a chunk of @a chunk frames of @a buffer in place through @a path: up to its oversampling factor, through
+      the drive stage and the filter stages or voices, back down and delayed up to the reported latency.@n
+      @a side is the slot of every stage the path runs, see runStage().
+    */
+    void runPath(RatePath& path, uint32_t side, float* buffer, uint32_t chunk)
+    {
+        // the filters and the crossfades between slots run on the oversampled rows, the gain at the host rate
+        const uint32_t factor = path.oversampler.getFactor();
+        float* const rows = factor > 1 ? path.oversampler.upsample(buffer, chunk) : buffer;
+        const uint32_t rowFrames = chunk * factor;
+
+        if (path.shaper.getShape() != Waveshaper<kNumLanes>::kShapeOff)
+        {
+            for (uint32_t i = 0; i < rowFrames; ++i)
+                driveRamp[i] = stageSmoothed[i / factor * SmootherBank::kNumLanes + kSmoothDrive];
+        }
+
+        if (fPolyActive)
+        {
+            runDrive(path, kDrivePre, rows, rowFrames, 0);
+            fVoices.process(rows, kNumLanes, rowFrames);
+            runDrive(path, kDriveBetween, rows, rowFrames, 0);
+        }
+        else
+        {
+            runStages(path, side, rows, rowFrames, chunk);
+        }
+
+        if (factor > 1)
+            path.oversampler.downsample(buffer, chunk);
+
+        if (path.delay != 0)
+        {
+            float* const delayed = path.delayRows + path.delay * kNumLanes;
+            std::memcpy(delayed, buffer, sizeof(float) * chunk * kNumLanes);
+            std::memcpy(buffer, path.delayRows, sizeof(float) * chunk * kNumLanes);
+            std::memmove(path.delayRows, path.delayRows + chunk * kNumLanes, sizeof(float) * path.delay * kNumLanes);
+        }
+    }
+
+   /**
+      Filter the @a frames oversampled rows of a chunk of @a chunk frames in place through the stages, as routed,
+      with the drive stage of @a path and the slots on @a side.
+    */
+    void runStages(RatePath& path, uint32_t side, float* rows, uint32_t frames, uint32_t chunk)
+    {
+        FilterStage& first = fStages[0];
+        FilterStage& second = fStages[1];
+
+        runDrive(path, kDrivePre, rows, frames, 0);
+
+        switch (fRoutingActive) {
+        case kRoutingSingle:
+            runStage(first, side, rows, frames, 0);
+            runDrive(path, kDriveBetween, rows, frames, 0);
+            break;
+        case kRoutingSerial:
+            runStage(first, side, rows, frames, 0);
+            runDrive(path, kDriveBetween, rows, frames, 0);
+            runStage(second, side, rows, frames, 0);
+            break;
+        case kRoutingParallel:
+            std::memcpy(stageWork, rows, sizeof(float) * frames * kNumLanes);
+            runStage(first, side, rows, frames, 0);
+            runDrive(path, kDriveBetween, rows, frames, 0);
+            runStage(second, side, stageWork, frames, 0);
+
+            // halfway between the two is their average
+            std::fill(fadeRamp, fadeRamp + frames, 0.5f);
+            laneOps.crossfadeRows(rows, stageWork, fadeRamp, frames, kNumLanes);
+            break;
+        case kRoutingStereo:
+            packStereoLanes(rows, stageWork, frames);
+            runStage(first, side, rows, frames, 0);
+            runStage(second, side, stageWork, frames, 0);
+            unpackStereoLanes(rows, rows, frames, 0);
+            runDrive(path, kDriveBetween, rows, frames, 0);
+            unpackStereoLanes(rows, stageWork, frames, 1);
+            break;
+        case kRoutingFeedback:
+            runFeedback(path, side, rows, frames, chunk);
+            break;
+        }
+
+        if (side != 0)
+            return;
+
+        for (uint32_t s = 0; s < getRunningStages(); ++s)
+            advanceFade(fStages[s], chunk);
+    }
+
+   /**
+      Run the drive stage of @a path over @a frames rows of @a rows if it is on and sits at @a position, the rows start
+      @a rowOffset rows into the current chunk.
+    */
+    void runDrive(RatePath& path, int position, float* rows, uint32_t frames, uint32_t rowOffset)
+    {
+        if (fDrivePosition == position)
+            path.shaper.process(rows, &driveRamp[rowOffset], frames);
+    }
+
+   /**
+      Filter @a frames rows of @a rows in place through both stages in series, adding the soft clipped output of the
+      second stage to the input of the first one, one sample later and scaled by the smoothed feedback amount.@n
+      The loop closes every sample, so the kernels run one row at a time.
+    */
+    void runFeedback(RatePath& path, uint32_t side, float* rows, uint32_t frames, uint32_t chunk)
+    {
+        const uint32_t factor = frames / chunk;
+        const __m128 limit = _mm_set1_ps(1.5f);
+        const __m128 cubic = _mm_set1_ps(4.0f / 27.0f);
+
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            float* const row = &rows[i * kNumLanes];
+            const __m128 amount = _mm_set1_ps(stageSmoothed[i / factor * SmootherBank::kNumLanes + kSmoothFeedback]);
+
+            for (uint32_t l = 0; l < kNumLanes; l += 4)
+            {
+                // x - 4/27 x^3 over +-1.5, flat at +-1 beyond
+                const __m128 y = _mm_min_ps(limit, _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), limit),
+                                                              _mm_load_ps(&path.feedbackRow[l])));
+                const __m128 clipped = _mm_sub_ps(y, _mm_mul_ps(cubic, _mm_mul_ps(y, _mm_mul_ps(y, y))));
+                _mm_store_ps(&row[l], _mm_add_ps(_mm_load_ps(&row[l]), _mm_mul_ps(amount, clipped)));
+            }
+
+            runStage(fStages[0], side, row, 1, i);
+            runDrive(path, kDriveBetween, row, 1, i);
+            runStage(fStages[1], side, row, 1, i);
+            std::memcpy(path.feedbackRow, row, sizeof(path.feedbackRow));
+        }
+    }
+
+   /**
+      Pack the odd lanes of the @a frames rows of @a rows, the right channel of each stereo pair, into the first lanes
+      of the rows of @a right, and the even ones into the first lanes of @a rows, the layout stateLane() gives the
+      stereo routing. The lanes after them are cleared.
+    */
+    void packStereoLanes(float* rows, float* right, uint32_t frames)
+    {
+        for (uint32_t i = 0; i < frames; ++i, rows += kNumLanes, right += kNumLanes)
+        {
+            for (uint32_t p = 0; p < kNumLanes / 2; ++p)
+            {
+                right[p] = rows[p * 2 + 1];
+                rows[p] = rows[p * 2];
+            }
+            std::memset(rows + kNumLanes / 2, 0, sizeof(float) * kNumLanes / 2);
+            std::memset(right + kNumLanes / 2, 0, sizeof(float) * kNumLanes / 2);
+        }
+    }
+
+   /**
+      Spread the first lanes of the @a frames rows of @a packed back out over the lanes of @a rows of parity @a odd,
+      undoing packStereoLanes(). @a packed may be @a rows for the even lanes.
+    */
+    void unpackStereoLanes(float* rows, const float* packed, uint32_t frames, uint32_t odd)
+    {
+        for (uint32_t i = 0; i < frames; ++i, rows += kNumLanes, packed += kNumLanes)
+        {
+            for (uint32_t p = kNumLanes / 2; p-- > 0;)
+                rows[p * 2 + odd] = packed[p];
+        }
+    }
+
+   /**
+      Whether every sample of the @a frames frames of every input channel is below kSilenceLevel.
+    */
+    bool inputIsSilent(const float* const* inputs, uint32_t frames) const
+    {
+        const __m128 level = _mm_set1_ps(kSilenceLevel);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (uint32_t c = 0; c < kNumChannels; ++c)
+        {
+            const float* const in = inputs[c];
+            __m128 loud = zero;
+            uint32_t i = 0;
+
+            for (; i + 4 <= frames; i += 4)
+            {
+                const __m128 x = _mm_loadu_ps(&in[i]);
+                loud = _mm_or_ps(loud, _mm_cmpge_ps(_mm_max_ps(x, _mm_sub_ps(zero, x)), level));
+            }
+
+            if (_mm_movemask_ps(loud) != 0)
+                return false;
+
+            for (; i < frames; ++i)
+            {
+                if (std::fabs(in[i]) >= kSilenceLevel)
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+   /**
+      Whether every register of every quad group of @a slot is below kSilenceLevel.
+    */
+    bool registersDecayed(const FilterSlot& slot) const
+    {
+        for (uint32_t g = 0; g < kNumGroups; ++g)
+        {
+            if (! FilterKernels::registersBelow(slot.state[g], kSilenceLevel))
+                return false;
+        }
+
+        return true;
+    }
+
+   /**
+      Clear the registers of every lane of @a slot whose total register energy is below kFlushEnergy.@n
+      A decaying tail is cut off long before it can reach the denormal range, whatever the MXCSR mode.
+    */
+    void flushQuietLanes(FilterSlot& slot)
+    {
+        for (uint32_t g = 0; g < kNumGroups; ++g)
+            FilterKernels::flushQuietLanes(slot.state[g], kFlushEnergy);
+    }
+
+   /**
+      Read @a frames frames starting at @a offset from the planar host buffers into the work buffer.
+      Channels are transposed four frames at a time, leftover frames are copied one by one.
+    */
+    void readChunk(const float* const* inputs, uint32_t offset, uint32_t frames)
+    {
+        const __m128 zero = _mm_setzero_ps();
+
+        for (uint32_t g = 0; g < kNumGroups; ++g)
+        {
+            float* row = &work[g * 4];
+            uint32_t i = 0;
+
+            for (; i + 4 <= frames; i += 4, row += 4 * kNumLanes)
+            {
+                __m128 v[4];
+                for (uint32_t k = 0; k < 4; ++k)
+                {
+                    const uint32_t c = g * 4 + k;
+                    v[k] = c < kNumChannels ? _mm_loadu_ps(&inputs[c][offset + i]) : zero;
+                }
+                _MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+
+                for (uint32_t k = 0; k < 4; ++k)
+                    _mm_store_ps(&row[k * kNumLanes], v[k]);
+            }
+
+            for (; i < frames; ++i, row += kNumLanes)
+            {
+                for (uint32_t k = 0; k < 4; ++k)
+                {
+                    const uint32_t c = g * 4 + k;
+                    row[k] = c < kNumChannels ? inputs[c][offset + i] : 0.0f;
+                }
+            }
+        }
+    }
+
+   /**
+      Write @a frames frames of the work buffer back to the planar host buffers, starting at @a offset.
+    */
+    void writeChunk(float* const* outputs, uint32_t offset, uint32_t frames)
+    {
+        for (uint32_t g = 0; g < kNumGroups; ++g)
+        {
+            const float* row = &work[g * 4];
+            uint32_t i = 0;
+
+            for (; i + 4 <= frames; i += 4, row += 4 * kNumLanes)
+            {
+                __m128 v[4];
+                for (uint32_t k = 0; k < 4; ++k)
+                    v[k] = _mm_load_ps(&row[k * kNumLanes]);
+                _MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+
+                for (uint32_t k = 0; k < 4; ++k)
+                {
+                    const uint32_t c = g * 4 + k;
+                    if (c < kNumChannels)
+                        _mm_storeu_ps(&outputs[c][offset + i], v[k]);
+                }
+            }
+
+            for (; i < frames; ++i, row += kNumLanes)
+            {
+                for (uint32_t k = 0; k < 4; ++k)
+                {
+                    const uint32_t c = g * 4 + k;
+                    if (c < kNumChannels)
+                        outputs[c][offset + i] = row[k];
+                }
+            }
+        }
+    }
+};
+
+#endif  // #ifndef FILTER_ENGINE_H
@@ -0,0 +1,268 @@
+/**
+ * Block kernels for the sst quad filter units.
+ *
+ * sst::filters::GetQFPtrFilterUnit hands out a function pointer, and calling it once per sample keeps the compiler
+ * from inlining or unrolling anything. Here every (FilterType, FilterSubType) pair gets its own kernel where the
+ * type and subtype are template arguments, so the unit lookup is constant-folded and the filter is flattened into
+ * a loop over the whole block. The kernel is looked up from a table once per block.
+ * The language does not promise that folding, so bench/CheckKernels.cmake reads the disassembly of the built kernels
+ * and fails if any of them still calls through a pointer.
+ */
+
+#ifndef FILTER_KERNELS_H
+#define FILTER_KERNELS_H
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <stdint.h>
+
+#include <sst/filters.h>
+
+#if defined(__GNUC__)
+#define FILTER_KERNEL_FLATTEN __attribute__((flatten))
+#else
+#define FILTER_KERNEL_FLATTEN
+#endif
+
+/**
+   Filter @a frames frames of one quad group in place.
+   @a rows points to the group's lanes of the first frame, consecutive frames are @a stride floats apart.
+   @a unit is only used by the generic kernel, specialized kernels resolve their unit at compile time.
+ */
+typedef void (*FilterBlockKernel)(sst::filters::FilterUnitQFPtr unit,
+                                  sst::filters::QuadFilterUnitState* __restrict state,
+                                  float* rows, uint32_t stride, uint32_t frames);
+
+/**
+   Fallback kernel going through the unit function pointer, for anything not in the table.
+ */
+static inline void filterBlockKernelGeneric(sst::filters::FilterUnitQFPtr unit,
+                                            sst::filters::QuadFilterUnitState* __restrict state,
+                                            float* rows, uint32_t stride, uint32_t frames)
+{
+    if (unit == nullptr)
+        return;
+
+    for (uint32_t i = 0; i < frames; ++i, rows += stride)
+        _mm_store_ps(rows, unit(state, _mm_load_ps(rows)));
+}
+
+/**
+   Kernel specialized for one filter type and subtype.
+   fut_none has no unit and leaves the signal untouched.
+ */
+template <int FT, int FST>
+FILTER_KERNEL_FLATTEN
+static void filterBlockKernel(sst::filters::FilterUnitQFPtr,
+                              sst::filters::QuadFilterUnitState* __restrict state,
+                              float* rows, uint32_t stride, uint32_t frames)
+{
+    if constexpr (FT != sst::filters::fut_none)
+    {
+        const sst::filters::FilterUnitQFPtr unit =
+            sst::filters::GetQFPtrFilterUnit(sst::filters::FilterType(FT), sst::filters::FilterSubType(FST));
+
+        for (uint32_t i = 0; i < frames; ++i, rows += stride)
+            _mm_store_ps(rows, unit(state, _mm_load_ps(rows)));
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+namespace FilterKernels {
+
+// subtypes past this one use the generic kernel, which keeps the number of instantiations reasonable
+static constexpr int kMaxSubTypes = 8;
+
+/**
+   Number of subtypes of type @a FT that get a specialized kernel.@n
+   Where sst's fut_subcount cannot be read at compile time the primary template instantiates every subtype up to
+   kMaxSubTypes, the specialization below takes over where it can.
+ */
+template <int FT, typename = void>
+struct SubTypeCount {
+    static constexpr int value = kMaxSubTypes;
+};
+
+template <int FT>
+struct SubTypeCount<FT, std::void_t<std::integral_constant<int, sst::filters::fut_subcount[FT]>>> {
+    static constexpr int value = std::min(std::max(int(sst::filters::fut_subcount[FT]), 1), kMaxSubTypes);
+};
+
+struct SubTypeRow {
+    FilterBlockKernel kernels[kMaxSubTypes];
+};
+
+struct Table {
+    SubTypeRow types[sst::filters::num_filter_types];
+};
+
+/**
+   Specialized kernel for @a FT and @a FST, or nullptr without instantiating anything if the subtype does not exist.
+ */
+template <int FT, int FST>
+static constexpr FilterBlockKernel makeKernel()
+{
+    if constexpr (FST < SubTypeCount<FT>::value)
+        return filterBlockKernel<FT, FST>;
+    else
+        return nullptr;
+}
+
+template <int FT, int... FST>
+static constexpr SubTypeRow makeRow(std::integer_sequence<int, FST...>)
+{
+    return {{ makeKernel<FT, FST>()... }};
+}
+
+template <int... FT>
+static constexpr Table makeTable(std::integer_sequence<int, FT...>)
+{
+    return {{ makeRow<FT>(std::make_integer_sequence<int, kMaxSubTypes>())... }};
+}
+
+static constexpr Table kTable = makeTable(std::make_integer_sequence<int, sst::filters::num_filter_types>());
+
+// length of the delay line every lane of a quad filter state needs, for the comb filters
+static constexpr int kDelayLineSize = sst::filters::utilities::MAX_FB_COMB + sst::filters::utilities::SincTable::FIRipol_N;
+
+/**
+   Clear the registers and coefficients of @a state and point its lanes at the cleared @a delayLines.@n
+   Only the first @a activeLanes lanes are marked active, padding lanes past the last channel carry no signal.
+ */
+static inline void resetState(sst::filters::QuadFilterUnitState& state, float (*delayLines)[kDelayLineSize],
+                              uint32_t activeLanes)
+{
+    std::fill(state.R, &state.R[sst::filters::n_filter_registers], _mm_setzero_ps());
+    std::fill(state.C, &state.C[sst::filters::n_cm_coeffs], _mm_setzero_ps());
+    std::fill(state.dC, &state.dC[sst::filters::n_cm_coeffs], _mm_setzero_ps());
+    std::memset(delayLines, 0, sizeof(float) * 4 * kDelayLineSize);
+
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        state.WP[i] = 0;
+        state.active[i] = i < activeLanes ? 0xFFFFFFFF : 0;
+        state.DB[i] = &delayLines[i][0];
+    }
+}
+
+/**
+   Bit mask of the lanes of @a state with a register at or above @a level, bit 0 for lane 0.
+ */
+static inline int loudLanes(const sst::filters::QuadFilterUnitState& state, float level)
+{
+    const __m128 limit = _mm_set1_ps(level);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 loud = zero;
+
+    for (int r = 0; r < sst::filters::n_filter_registers; ++r)
+    {
+        const __m128 x = state.R[r];
+        loud = _mm_or_ps(loud, _mm_cmpge_ps(_mm_max_ps(x, _mm_sub_ps(zero, x)), limit));
+    }
+
+    return _mm_movemask_ps(loud);
+}
+
+/**
+   Whether every register of every lane of @a state is below @a level.
+ */
+static inline bool registersBelow(const sst::filters::QuadFilterUnitState& state, float level)
+{
+    return loudLanes(state, level) == 0;
+}
+
+/**
+   Clear the registers of every lane of @a state whose total register energy is below @a energy.
+ */
+static inline void flushQuietLanes(sst::filters::QuadFilterUnitState& state, float energy)
+{
+    __m128* const R = state.R;
+
+    __m128 sum = _mm_setzero_ps();
+    for (int r = 0; r < sst::filters::n_filter_registers; ++r)
+        sum = _mm_add_ps(sum, _mm_mul_ps(R[r], R[r]));
+
+    const __m128 quiet = _mm_cmplt_ps(sum, _mm_set1_ps(energy));
+    if (_mm_movemask_ps(quiet) == 0)
+        return;
+
+    for (int r = 0; r < sst::filters::n_filter_registers; ++r)
+        R[r] = _mm_andnot_ps(quiet, R[r]);
+}
+
+/**
+   Clear the registers and delay line of lane @a lane of @a state, leaving the other lanes running.
+ */
+static inline void resetLane(sst::filters::QuadFilterUnitState& state, uint32_t lane)
+{
+    for (int r = 0; r < sst::filters::n_filter_registers; ++r)
+        state.R[r][lane] = 0.0f;
+
+    std::memset(state.DB[lane], 0, sizeof(float) * kDelayLineSize);
+    state.WP[lane] = 0;
+}
+
+/**
+   Move lane @a fromLane of @a from, registers, coefficients and delay line, to lane @a toLane of @a to, and clear
+   the lane it came from. Marks @a toLane active and @a fromLane inactive.
+ */
+static inline void moveLane(sst::filters::QuadFilterUnitState& from, uint32_t fromLane,
+                            sst::filters::QuadFilterUnitState& to, uint32_t toLane)
+{
+    for (int r = 0; r < sst::filters::n_filter_registers; ++r)
+        to.R[r][toLane] = from.R[r][fromLane];
+
+    for (int f = 0; f < sst::filters::n_cm_coeffs; ++f)
+    {
+        to.C[f][toLane] = from.C[f][fromLane];
+        to.dC[f][toLane] = from.dC[f][fromLane];
+    }
+
+    std::memcpy(to.DB[toLane], from.DB[fromLane], sizeof(float) * kDelayLineSize);
+    to.WP[toLane] = from.WP[fromLane];
+    to.active[toLane] = 0xFFFFFFFF;
+
+    resetLane(from, fromLane);
+    from.active[fromLane] = 0;
+}
+
+/**
+   Ramp the coefficients of @a state by @a frames samples without running its unit, the way they would have moved
+   had it run, so a state skipped for a block stays in step with the ones that were not.
+ */
+static inline void advanceCoefficients(sst::filters::QuadFilterUnitState& state, uint32_t frames)
+{
+    const __m128 n = _mm_set1_ps((float)frames);
+    for (int f = 0; f < sst::filters::n_cm_coeffs; ++f)
+        state.C[f] = _mm_add_ps(state.C[f], _mm_mul_ps(state.dC[f], n));
+}
+
+/**
+   Number of subtypes sst provides for @a type, types without subtypes still take subtype 0.
+ */
+static inline int numSubTypes(int type)
+{
+    return sst::filters::fut_subcount[type] > 0 ? sst::filters::fut_subcount[type] : 1;
+}
+
+/**
+   Kernel for @a type and @a subType, or the generic one if the pair is not in the table.
+ */
+static inline FilterBlockKernel get(sst::filters::FilterType type, sst::filters::FilterSubType subType)
+{
+    if (type < 0 || type >= sst::filters::num_filter_types)
+        return filterBlockKernelGeneric;
+
+    if (subType < 0 || subType >= numSubTypes(type) || subType >= kMaxSubTypes)
+        return filterBlockKernelGeneric;
+
+    const FilterBlockKernel kernel = kTable.types[type].kernels[subType];
+    return kernel != nullptr ? kernel : filterBlockKernelGeneric;
+}
+
+} // namespace FilterKernels
+
+#endif  // #ifndef FILTER_KERNELS_H
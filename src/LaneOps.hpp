@@ -0,0 +1,311 @@
+/**
+ * Wide-lane block operations with runtime CPU dispatch.
+ *
+ * The sst filter units only come in a 4-lane (__m128) flavour, so the filter itself always runs on quads.
+ * Everything around it operates on frame-major rows holding every lane of the plugin, one row per frame,
+ * and those rows are processed here with the widest vectors the CPU offers.
+ * The SSE versions are the fallback and are always available, through simde on non-x86 targets.
+ * The AVX2 and AVX-512 versions are only compiled for x86 with SSE2 and GCC/Clang and are picked once at startup
+ * by looking at CPUID.
+ */
+
+#ifndef LANE_OPS_H
+#define LANE_OPS_H
+
+#include <stdint.h>
+
+#include "SimdSetup.hpp"
+
+#if SIMD_NATIVE_SSE && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LANE_OPS_HAVE_X86_DISPATCH 1
+#include <immintrin.h>
+#define LANE_OPS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define LANE_OPS_HAVE_X86_DISPATCH 0
+#endif
+
+enum SimdLevel {
+    kSimdSSE = 0,
+    kSimdAVX2,
+    kSimdAVX512
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// SSE, 4 lanes
+
+/**
+   Multiply every row of @a frames rows of @a lanes floats by its own gain.
+   @a lanes must be a multiple of 4.
+ */
+static inline void scaleRowsSSE(float* rows, const float* gain, uint32_t frames, uint32_t lanes)
+{
+    for (uint32_t i = 0; i < frames; ++i, rows += lanes)
+    {
+        const __m128 g = _mm_set1_ps(gain[i]);
+        for (uint32_t l = 0; l < lanes; l += 4)
+            _mm_storeu_ps(&rows[l], _mm_mul_ps(_mm_loadu_ps(&rows[l]), g));
+    }
+}
+
+/**
+   Move every row of @a rows towards the matching row of @a other by its own amount, 0 keeps @a rows and 1 gives @a other.
+   @a lanes must be a multiple of 4.
+ */
+static inline void crossfadeRowsSSE(float* rows, const float* other, const float* amount, uint32_t frames, uint32_t lanes)
+{
+    for (uint32_t i = 0; i < frames; ++i, rows += lanes, other += lanes)
+    {
+        const __m128 x = _mm_set1_ps(amount[i]);
+        for (uint32_t l = 0; l < lanes; l += 4)
+        {
+            const __m128 a = _mm_loadu_ps(&rows[l]);
+            _mm_storeu_ps(&rows[l], _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&other[l]), a), x)));
+        }
+    }
+}
+
+/**
+   Blend every row of @a rows, the filtered signal, with the matching row of @a dry and apply the gain in the same pass,
+   rows = gain * (dry + mix * (rows - dry)).@n
+   The gain and mix of frame i are gain[i * stride] and mix[i * stride], so they can be read straight out of
+   interleaved smoother rows. @a lanes must be a multiple of 4.
+ */
+static inline void gainMixRowsSSE(float* rows, const float* dry, const float* gain, const float* mix, uint32_t stride,
+                                  uint32_t frames, uint32_t lanes)
+{
+    for (uint32_t i = 0; i < frames; ++i, rows += lanes, dry += lanes, gain += stride, mix += stride)
+    {
+        const __m128 w = _mm_set1_ps(*gain * *mix);
+        const __m128 d = _mm_set1_ps(*gain - *gain * *mix);
+        for (uint32_t l = 0; l < lanes; l += 4)
+            _mm_storeu_ps(&rows[l], _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&rows[l]), w),
+                                               _mm_mul_ps(_mm_loadu_ps(&dry[l]), d)));
+    }
+}
+
+/**
+   Largest of the four floats in @a v.
+ */
+static inline float horizontalMaxSSE(__m128 v)
+{
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+/**
+   Largest absolute value in @a frames rows of @a lanes floats.
+   @a lanes must be a multiple of 4.
+ */
+static inline float peakRowsSSE(const float* rows, uint32_t frames, uint32_t lanes)
+{
+    const __m128 zero = _mm_setzero_ps();
+    __m128 peak = zero;
+
+    for (uint32_t i = 0, n = frames * lanes; i < n; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(&rows[i]);
+        peak = _mm_max_ps(peak, _mm_max_ps(x, _mm_sub_ps(zero, x)));
+    }
+
+    return horizontalMaxSSE(peak);
+}
+
+#if LANE_OPS_HAVE_X86_DISPATCH
+// --------------------------------------------------------------------------------------------------------------------
+// AVX2, 8 lanes
+
+LANE_OPS_TARGET("avx2")
+static inline void scaleRowsAVX2(float* rows, const float* gain, uint32_t frames, uint32_t lanes)
+{
+    for (uint32_t i = 0; i < frames; ++i, rows += lanes)
+    {
+        const __m256 g = _mm256_set1_ps(gain[i]);
+        uint32_t l = 0;
+        for (; l + 8 <= lanes; l += 8)
+            _mm256_storeu_ps(&rows[l], _mm256_mul_ps(_mm256_loadu_ps(&rows[l]), g));
+        for (; l < lanes; l += 4)
+            _mm_storeu_ps(&rows[l], _mm_mul_ps(_mm_loadu_ps(&rows[l]), _mm_set1_ps(gain[i])));
+    }
+}
+
+LANE_OPS_TARGET("avx2")
+static inline void crossfadeRowsAVX2(float* rows, const float* other, const float* amount, uint32_t frames, uint32_t lanes)
+{
+    for (uint32_t i = 0; i < frames; ++i, rows += lanes, other += lanes)
+    {
+        const __m256 x = _mm256_set1_ps(amount[i]);
+        uint32_t l = 0;
+        for (; l + 8 <= lanes; l += 8)
+        {
+            const __m256 a = _mm256_loadu_ps(&rows[l]);
+            _mm256_storeu_ps(&rows[l], _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&other[l]), a), x)));
+        }
+        for (; l < lanes; l += 4)
+        {
+            const __m128 a = _mm_loadu_ps(&rows[l]);
+            _mm_storeu_ps(&rows[l], _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&other[l]), a), _mm_set1_ps(amount[i]))));
+        }
+    }
+}
+
+LANE_OPS_TARGET("avx2")
+static inline void gainMixRowsAVX2(float* rows, const float* dry, const float* gain, const float* mix, uint32_t stride,
+                                   uint32_t frames, uint32_t lanes)
+{
+    for (uint32_t i = 0; i < frames; ++i, rows += lanes, dry += lanes, gain += stride, mix += stride)
+    {
+        const __m256 w = _mm256_set1_ps(*gain * *mix);
+        const __m256 d = _mm256_set1_ps(*gain - *gain * *mix);
+        uint32_t l = 0;
+        for (; l + 8 <= lanes; l += 8)
+            _mm256_storeu_ps(&rows[l], _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&rows[l]), w),
+                                                     _mm256_mul_ps(_mm256_loadu_ps(&dry[l]), d)));
+        for (; l < lanes; l += 4)
+            _mm_storeu_ps(&rows[l], _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&rows[l]), _mm_set1_ps(*gain * *mix)),
+                                               _mm_mul_ps(_mm_loadu_ps(&dry[l]), _mm_set1_ps(*gain - *gain * *mix))));
+    }
+}
+
+LANE_OPS_TARGET("avx2")
+static inline float peakRowsAVX2(const float* rows, uint32_t frames, uint32_t lanes)
+{
+    const __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 peak = _mm256_setzero_ps();
+
+    const uint32_t n = frames * lanes;
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        peak = _mm256_max_ps(peak, _mm256_and_ps(_mm256_loadu_ps(&rows[i]), mask));
+
+    __m128 peak4 = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+    for (; i < n; i += 4)
+        peak4 = _mm_max_ps(peak4, _mm_and_ps(_mm_loadu_ps(&rows[i]), _mm256_castps256_ps128(mask)));
+
+    return horizontalMaxSSE(peak4);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// AVX-512, 16 lanes
+
+LANE_OPS_TARGET("avx512f")
+static inline void scaleRowsAVX512(float* rows, const float* gain, uint32_t frames, uint32_t lanes)
+{
+    for (uint32_t i = 0; i < frames; ++i, rows += lanes)
+    {
+        const __m512 g = _mm512_set1_ps(gain[i]);
+        uint32_t l = 0;
+        for (; l + 16 <= lanes; l += 16)
+            _mm512_storeu_ps(&rows[l], _mm512_mul_ps(_mm512_loadu_ps(&rows[l]), g));
+        for (; l < lanes; l += 4)
+            _mm_storeu_ps(&rows[l], _mm_mul_ps(_mm_loadu_ps(&rows[l]), _mm_set1_ps(gain[i])));
+    }
+}
+
+LANE_OPS_TARGET("avx512f")
+static inline void crossfadeRowsAVX512(float* rows, const float* other, const float* amount, uint32_t frames, uint32_t lanes)
+{
+    for (uint32_t i = 0; i < frames; ++i, rows += lanes, other += lanes)
+    {
+        const __m512 x = _mm512_set1_ps(amount[i]);
+        uint32_t l = 0;
+        for (; l + 16 <= lanes; l += 16)
+        {
+            const __m512 a = _mm512_loadu_ps(&rows[l]);
+            _mm512_storeu_ps(&rows[l], _mm512_add_ps(a, _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(&other[l]), a), x)));
+        }
+        for (; l < lanes; l += 4)
+        {
+            const __m128 a = _mm_loadu_ps(&rows[l]);
+            _mm_storeu_ps(&rows[l], _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&other[l]), a), _mm_set1_ps(amount[i]))));
+        }
+    }
+}
+
+LANE_OPS_TARGET("avx512f")
+static inline void gainMixRowsAVX512(float* rows, const float* dry, const float* gain, const float* mix, uint32_t stride,
+                                     uint32_t frames, uint32_t lanes)
+{
+    for (uint32_t i = 0; i < frames; ++i, rows += lanes, dry += lanes, gain += stride, mix += stride)
+    {
+        const __m512 w = _mm512_set1_ps(*gain * *mix);
+        const __m512 d = _mm512_set1_ps(*gain - *gain * *mix);
+        uint32_t l = 0;
+        for (; l + 16 <= lanes; l += 16)
+            _mm512_storeu_ps(&rows[l], _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(&rows[l]), w),
+                                                     _mm512_mul_ps(_mm512_loadu_ps(&dry[l]), d)));
+        for (; l < lanes; l += 4)
+            _mm_storeu_ps(&rows[l], _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&rows[l]), _mm_set1_ps(*gain * *mix)),
+                                               _mm_mul_ps(_mm_loadu_ps(&dry[l]), _mm_set1_ps(*gain - *gain * *mix))));
+    }
+}
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+
+/**
+   Table of block operations for one instruction set.
+ */
+struct LaneOps {
+    SimdLevel level;
+    const char* name;
+    void (*scaleRows)(float* rows, const float* gain, uint32_t frames, uint32_t lanes);
+    void (*crossfadeRows)(float* rows, const float* other, const float* amount, uint32_t frames, uint32_t lanes);
+    float (*peakRows)(const float* rows, uint32_t frames, uint32_t lanes);
+    void (*gainMixRows)(float* rows, const float* dry, const float* gain, const float* mix, uint32_t stride,
+                        uint32_t frames, uint32_t lanes);
+
+    /**
+       Widest instruction set supported by the running CPU.
+     */
+    static SimdLevel detect()
+    {
+#if LANE_OPS_HAVE_X86_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return kSimdAVX512;
+        if (__builtin_cpu_supports("avx2"))
+            return kSimdAVX2;
+#endif
+        return kSimdSSE;
+    }
+
+    /**
+       Operations for @a level, falling back to SSE for anything not compiled in.
+     */
+    static const LaneOps& get(SimdLevel level)
+    {
+        static const LaneOps sse = { kSimdSSE, "SSE", scaleRowsSSE, crossfadeRowsSSE, peakRowsSSE,
+                                        gainMixRowsSSE };
+#if LANE_OPS_HAVE_X86_DISPATCH
+        static const LaneOps avx2 = { kSimdAVX2, "AVX2", scaleRowsAVX2, crossfadeRowsAVX2, peakRowsAVX2,
+                                          gainMixRowsAVX2 };
+        // finding the peak is bound by the loads, 512-bit registers do not make it faster than AVX2
+        static const LaneOps avx512 = { kSimdAVX512, "AVX-512", scaleRowsAVX512, crossfadeRowsAVX512, peakRowsAVX2,
+                                            gainMixRowsAVX512 };
+
+        switch (level) {
+        case kSimdAVX512:
+            return avx512;
+        case kSimdAVX2:
+            return avx2;
+        default:
+            break;
+        }
+#else
+        (void)level;
+#endif
+        return sse;
+    }
+
+    /**
+       Operations for the running CPU, detected once on first use.
+     */
+    static const LaneOps& best()
+    {
+        static const LaneOps& ops = get(detect());
+        return ops;
+    }
+};
+
+#endif  // #ifndef LANE_OPS_H
@@ -0,0 +1,152 @@
+/**
+ * CPU load governor.
+ *
+ * Compares the wall-clock time of every processing call with the realtime budget of the frames it processed,
+ * and steps the quality down while the load stays above a share of that budget, and back up once it has stayed
+ * well below it for a while. The thresholds and hold times are apart so the tier does not flap around the limit,
+ * and every step down doubles the time before the next step up, for loads that only fit the budget one tier down.
+ */
+
+#ifndef LOAD_GOVERNOR_H
+#define LOAD_GOVERNOR_H
+
+#include <chrono>
+#include <stdint.h>
+
+class LoadGovernor {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+   /**
+      Set the share of the realtime budget processing may use, 0.75 for 75%, or 0 to never step down.
+    */
+    void setBudget(float share) noexcept
+    {
+        fBudget = share;
+        if (share <= 0.0f)
+            fSteps = 0;
+    }
+
+   /**
+      Set the number of steps quality may go down, usually the number of tiers below the selected one.
+    */
+    void setMaxSteps(int steps) noexcept
+    {
+        fMaxSteps = steps > 0 ? steps : 0;
+        if (fSteps > fMaxSteps)
+            fSteps = fMaxSteps;
+    }
+
+    void setSampleRate(double sampleRate) noexcept
+    {
+        fSampleRate = sampleRate;
+    }
+
+   /**
+      Forget the measured load and the step history, for example after activation.
+    */
+    void reset() noexcept
+    {
+        fSteps = 0;
+        fUpSeconds = kUpSeconds;
+        restart();
+    }
+
+   /**
+      How many tiers below the selected one processing should run.
+    */
+    int getSteps() const noexcept
+    {
+        return fSteps;
+    }
+
+   /**
+      Smoothed share of the realtime budget used, 1 means processing takes as long as the audio lasts.
+    */
+    float getLoad() const noexcept
+    {
+        return fLoad;
+    }
+
+   /**
+      Account for a call that processed @a frames frames between @a start and @a end.@n
+      Returns true if getSteps() changed.
+    */
+    bool update(Clock::time_point start, Clock::time_point end, uint32_t frames) noexcept
+    {
+        if (frames == 0 || fBudget <= 0.0f)
+            return false;
+
+        const double elapsed = std::chrono::duration<double>(end - start).count();
+        const float load = (float)(elapsed * fSampleRate / frames);
+
+        // smooth over about kLoadSeconds of audio, whatever the block size
+        const float a = (float)(frames / (kLoadSeconds * fSampleRate));
+        fLoad += (a < 1.0f ? a : 1.0f) * (load - fLoad);
+
+        if (fLoad > fBudget)
+        {
+            fUnderFrames = 0;
+            fOverFrames += frames;
+
+            if (fOverFrames >= kDownSeconds * fSampleRate && fSteps < fMaxSteps)
+            {
+                ++fSteps;
+                fUpSeconds = fUpSeconds * 2.0 < kMaxUpSeconds ? fUpSeconds * 2.0 : kMaxUpSeconds;
+                restart();
+                return true;
+            }
+        }
+        else if (fLoad < fBudget * kUpShare)
+        {
+            fOverFrames = 0;
+            fUnderFrames += frames;
+
+            if (fUnderFrames >= fUpSeconds * fSampleRate && fSteps > 0)
+            {
+                --fSteps;
+                restart();
+                return true;
+            }
+        }
+        else
+        {
+            fOverFrames = 0;
+            fUnderFrames = 0;
+        }
+
+        return false;
+    }
+
+private:
+    // time constant of the load average
+    static constexpr double kLoadSeconds = 0.05;
+    // how long the load must stay over the budget to step down
+    static constexpr double kDownSeconds = 0.1;
+    // how long, and how far below the budget, the load must stay to step back up
+    static constexpr double kUpSeconds = 1.0;
+    static constexpr double kMaxUpSeconds = 60.0;
+    static constexpr float kUpShare = 0.4f;
+
+    double fSampleRate = 44100.0;
+    float fBudget = 0.0f;
+    int fMaxSteps = 0;
+    int fSteps = 0;
+
+    float fLoad = 0.0f;
+    uint64_t fOverFrames = 0;
+    uint64_t fUnderFrames = 0;
+    double fUpSeconds = kUpSeconds;
+
+   /**
+      Start measuring afresh after a step, the load of the previous tier says nothing about the new one.
+    */
+    void restart() noexcept
+    {
+        fLoad = 0.0f;
+        fOverFrames = 0;
+        fUnderFrames = 0;
+    }
+};
+
+#endif  // #ifndef LOAD_GOVERNOR_H
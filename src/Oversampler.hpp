@@ -0,0 +1,286 @@
+/**
+ * Polyphase half-band oversampling for frame-major rows.
+ *
+ * Up to three cascaded 2x stages give 2x, 4x or 8x. Each stage is a windowed-sinc half-band FIR, where every other
+ * tap is zero except the centre one, split into its two polyphase branches so only the non-zero taps are computed.
+ * The rows hold Lanes floats per frame, the same layout as the plugin work buffer, so every tap is applied to four
+ * lanes at once with the same SSE registers the quad filter states use.
+ *
+ * The first stage, closest to the host rate, has the steepest filter, the later ones only need to reject images
+ * far above the audio band and are much shorter.
+ */
+
+#ifndef OVERSAMPLER_H
+#define OVERSAMPLER_H
+
+#include "SimdSetup.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+template <uint32_t Lanes, uint32_t MaxFrames>
+class Oversampler
+{
+public:
+    static_assert(Lanes % 4 == 0, "Oversampler rows must hold a multiple of 4 lanes");
+
+    static constexpr uint32_t kMaxStages = 3;
+    static constexpr uint32_t kMaxFactor = 1u << kMaxStages;
+    // latency at kMaxFactor, the most getLatency() returns
+    static constexpr uint32_t kMaxLatency = 29;
+
+    Oversampler()
+    {
+        // every stage writes straight into the input of the next, their history rows just before it
+        float* rows = fArena;
+        for (uint32_t s = 0; s < kMaxStages; ++s)
+        {
+            fUpInput[s] = rows + upHistory(s) * Lanes;
+            rows += upRows(s) * Lanes;
+        }
+        for (uint32_t s = 0; s < kMaxStages; ++s)
+        {
+            fDownInput[s] = rows + downHistory(s) * Lanes;
+            rows += downRows(s) * Lanes;
+        }
+
+        for (uint32_t s = 0; s < kMaxStages; ++s)
+            design(s);
+        reset();
+    }
+
+   /**
+      Set the oversampling factor, 1, 2, 4 or 8, and clear the filter history.
+      Returns false and leaves the factor unchanged for anything else.
+    */
+    bool setFactor(uint32_t factor)
+    {
+        const int stages = numStages(factor);
+        if (stages < 0)
+            return false;
+
+        fNumStages = (uint32_t)stages;
+        fLatency = latencyOf(factor);
+        fPad = (uint32_t)std::lround((fLatency - exactLatency(fNumStages)) * (1u << fNumStages));
+
+        reset();
+        return true;
+    }
+
+   /**
+      Delay added by upsampling and downsampling again at @a factor, in host-rate frames, 0 for an invalid factor.
+    */
+    static uint32_t latencyOf(uint32_t factor) noexcept
+    {
+        const int stages = numStages(factor);
+        return stages > 0 ? (uint32_t)std::ceil(exactLatency((uint32_t)stages)) : 0;
+    }
+
+    uint32_t getFactor() const noexcept
+    {
+        return 1u << fNumStages;
+    }
+
+   /**
+      Delay added by upsampling and downsampling again, in host-rate frames.
+    */
+    uint32_t getLatency() const noexcept
+    {
+        return fLatency;
+    }
+
+    void reset()
+    {
+        std::memset(fArena, 0, sizeof(fArena));
+    }
+
+   /**
+      Upsample @a frames rows by the current factor.@n
+      Returns the frames * factor rows, which may be processed in place before they are passed to downsample().
+      Must not be called with a factor of 1.
+    */
+    float* upsample(const float* rows, uint32_t frames)
+    {
+        std::memcpy(upInput(0), rows, sizeof(float) * frames * Lanes);
+
+        for (uint32_t s = 0; s < fNumStages; ++s)
+        {
+            float* const dest = s + 1 < fNumStages ? upInput(s + 1) : downInput(fNumStages - 1);
+            upsampleStage(s, frames << s, dest);
+        }
+
+        return downInput(fNumStages - 1);
+    }
+
+   /**
+      Downsample the rows returned by the last upsample() call back into @a frames rows of @a rows.
+    */
+    void downsample(float* rows, uint32_t frames)
+    {
+        for (uint32_t s = fNumStages; s-- > 0;)
+            downsampleStage(s, frames << s, s > 0 ? downInput(s - 1) : rows);
+    }
+
+private:
+    // even taps T of each stage, which are all non-zero, the full filter has 2T - 1 taps
+    static constexpr uint32_t kTaps[kMaxStages] = { 24, 10, 6 };
+    static constexpr uint32_t kMaxTaps = 24;
+
+    // each stage pair delays by T - 1 frames at its lower rate, the last downsampler may add up to this many rows
+    // at the highest rate so the total comes out at a whole number of host frames
+    static constexpr uint32_t kMaxPad = 8;
+
+    // the upsampler keeps T - 1 rows of input history and the downsampler 2T - 2, plus the padding
+    static constexpr uint32_t upHistory(uint32_t s) { return kTaps[s] - 1; }
+    static constexpr uint32_t downHistory(uint32_t s) { return 2 * kTaps[s] - 2 + kMaxPad; }
+    static constexpr uint32_t upRows(uint32_t s) { return upHistory(s) + (MaxFrames << s); }
+    static constexpr uint32_t downRows(uint32_t s) { return downHistory(s) + (MaxFrames << (s + 1)); }
+
+    static int numStages(uint32_t factor) noexcept
+    {
+        switch (factor) {
+        case 1: return 0;
+        case 2: return 1;
+        case 4: return 2;
+        case 8: return 3;
+        default: return -1;
+        }
+    }
+
+    // stages past the first delay by half a frame or less, the last one is padded up to a whole frame
+    static double exactLatency(uint32_t stages) noexcept
+    {
+        double latency = 0.0;
+        for (uint32_t s = 0; s < stages; ++s)
+            latency += (kTaps[s] - 1.0) / (1u << s);
+        return latency;
+    }
+
+    static constexpr uint32_t arenaRows()
+    {
+        uint32_t rows = 0;
+        for (uint32_t s = 0; s < kMaxStages; ++s)
+            rows += upRows(s) + downRows(s);
+        return rows;
+    }
+
+    uint32_t fNumStages = 0;
+    uint32_t fLatency = 0;
+    uint32_t fPad = 0;
+
+    // the even taps of every stage, h[0], h[2], ..., the odd ones are zero apart from the centre tap of 0.5
+    float fCoeffs[kMaxStages][kMaxTaps];
+
+    // history and input rows of every stage
+    float fArena alignas(16)[arenaRows() * Lanes];
+
+    // first input row of every upsampling and downsampling stage, inside fArena
+    float* fUpInput[kMaxStages];
+    float* fDownInput[kMaxStages];
+
+    float* upInput(uint32_t s) { return fUpInput[s]; }
+    float* downInput(uint32_t s) { return fDownInput[s]; }
+
+    void design(uint32_t s)
+    {
+        // Kaiser-windowed half-band sinc centred on tap T - 1, only the even taps are kept
+        const uint32_t T = kTaps[s];
+        const double centre = T - 1.0;
+        const double beta = s == 0 ? 9.0 : 7.0;
+
+        double sum = 0.0;
+        for (uint32_t j = 0; j < T; ++j)
+        {
+            const double x = 2.0 * j - centre;
+            const double r = x / T;
+            const double sinc = std::sin(M_PI * x * 0.5) / (M_PI * x);
+            fCoeffs[s][j] = (float)(sinc * besselI0(beta * std::sqrt(1.0 - r * r)) / besselI0(beta));
+            sum += fCoeffs[s][j];
+        }
+
+        // the even taps must add up to 0.5 for unity gain at DC
+        for (uint32_t j = 0; j < T; ++j)
+            fCoeffs[s][j] = (float)(fCoeffs[s][j] * 0.5 / sum);
+    }
+
+    static double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x * 0.5 / k) * (x * 0.5 / k);
+            sum += term;
+        }
+        return sum;
+    }
+
+   /**
+      2x upsampling of stage @a s, @a frames input rows into 2 * @a frames rows of @a dest.
+    */
+    void upsampleStage(uint32_t s, uint32_t frames, float* dest)
+    {
+        const uint32_t T = kTaps[s];
+        const uint32_t history = upHistory(s);
+        float* const base = upInput(s) - history * Lanes;
+        const float* const coeffs = fCoeffs[s];
+
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            // newest input row, the branches look back from here
+            const float* const x = &base[(history + i) * Lanes];
+            float* const even = &dest[(2 * i) * Lanes];
+            float* const odd = even + Lanes;
+
+            for (uint32_t l = 0; l < Lanes; l += 4)
+            {
+                const float* const in = x + l;
+
+                __m128 acc = _mm_setzero_ps();
+                for (uint32_t j = 0; j < T; ++j)
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(coeffs[j]), _mm_load_ps(in - j * Lanes)));
+
+                // zero stuffing halves the level, both branches make up for it with a gain of 2
+                _mm_store_ps(&even[l], _mm_add_ps(acc, acc));
+                _mm_store_ps(&odd[l], _mm_load_ps(in - (T / 2 - 1) * Lanes));
+            }
+        }
+
+        std::memmove(base, &base[frames * Lanes], sizeof(float) * history * Lanes);
+    }
+
+   /**
+      2x downsampling of stage @a s, 2 * @a frames input rows into @a frames rows of @a dest.
+    */
+    void downsampleStage(uint32_t s, uint32_t frames, float* dest)
+    {
+        const uint32_t T = kTaps[s];
+        const uint32_t history = downHistory(s);
+        float* const base = downInput(s) - history * Lanes;
+        const float* const coeffs = fCoeffs[s];
+        const uint32_t pad = s + 1 == fNumStages ? fPad : 0;
+        const __m128 half = _mm_set1_ps(0.5f);
+
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            // every other input row is dropped, the even branch runs on the kept ones and the centre tap in between
+            const float* const x = &base[(history + 2 * i) * Lanes];
+            float* const out = &dest[i * Lanes];
+
+            for (uint32_t l = 0; l < Lanes; l += 4)
+            {
+                const float* const in = x + l - pad * Lanes;
+
+                __m128 acc = _mm_mul_ps(half, _mm_load_ps(in - (T - 1) * Lanes));
+                for (uint32_t j = 0; j < T; ++j)
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(coeffs[j]), _mm_load_ps(in - 2 * j * Lanes)));
+
+                _mm_store_ps(&out[l], acc);
+            }
+        }
+
+        std::memmove(base, &base[2 * frames * Lanes], sizeof(float) * history * Lanes);
+    }
+};
+
+#endif  // #ifndef OVERSAMPLER_H
@@ -6,31 +6,12 @@
  */
 
 #include "DistrhoPlugin.hpp"
-#include "CParamSmooth.hpp"
-
-#include <memory>
-#include <atomic>
-
-#include <sst/filters.h>
+#include "FilterEngine.hpp"
+#include "LoadGovernor.hpp"
+#include "RtLog.hpp"
 
 // --------------------------------------------------------------------------------------------------------------------
 
-#ifndef MIN
-#define MIN(a,b) ( (a) < (b) ? (a) : (b) )
-#endif
-
-#ifndef MAX
-#define MAX(a,b) ( (a) > (b) ? (a) : (b) )
-#endif
-
-#ifndef CLAMP
-#define CLAMP(v, min, max) (MIN((max), MAX((min), (v))))
-#endif
-
-#ifndef DB_CO
-#define DB_CO(g) ((g) > -90.0f ? powf(10.0f, (g) * 0.05f) : 0.0f)
-#endif
-
 START_NAMESPACE_DISTRHO
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -41,30 +22,65 @@ class ImGuiPluginDSP : public Plugin
         kParamGain = 0,
         kParamFreq,
         kParamRes,
+        kParamType,
+        kParamSubType,
+        kParamOversampling,
+        kParamQuality,
+        kParamOffline,
+        kParamCpuBudget,
+        kParamActiveQuality,
+        kParamMix,
+        kParamPolyMode,
+        kParamKeyTrack,
+        kParamVelocityToRes,
+        kParamRouting,
+        kParamType2,
+        kParamSubType2,
+        kParamFreq2,
+        kParamRes2,
+        kParamFeedback,
+        kParamDriveShape,
+        kParamDrive,
+        kParamDrivePosition,
         kParamCount
     };
 
-    double fSampleRate = getSampleRate();
     float fGainDB = 0.0f;
-    float fGainLinear = 1.0f;
-    std::unique_ptr<CParamSmooth> fSmoothGain = std::make_unique<CParamSmooth>(20.0f, fSampleRate);
-
     float fFreqNote = 0.0f;
     float fResonance = 0.5f;
-    sst::filters::FilterUnitQFPtr FUnit;
-
-    sst::filters::FilterCoefficientMaker<> coeffMaker;
-    sst::filters::QuadFilterUnitState filterState{};
-
-    // sst::filters::FilterType ft = sst::filters::FilterType::fut_lpmoog;
-    sst::filters::FilterType ft = sst::filters::FilterType::fut_vintageladder;
-    // sst::filters::FilterSubType fst = sst::filters::FilterSubType::st_lpmoog_24dB;
-    sst::filters::FilterSubType fst = sst::filters::FilterSubType(0);
-
-    std::atomic<bool> dirtyParamFreq = false;
-
-    float delayBuffer[4][sst::filters::utilities::MAX_FB_COMB +
-                                sst::filters::utilities::SincTable::FIRipol_N];
+    int fFilterType = sst::filters::fut_vintageladder;
+    int fFilterSubType = 0;
+    int fOversampling = 0;
+    int fQuality = FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kQualityNormal;
+    bool fOffline = false;
+    float fCpuBudget = 75.0f;
+    float fMix = 100.0f;
+    bool fPolyMode = false;
+    float fKeyTrack = 100.0f;
+    float fVelocityToRes = 0.0f;
+    int fRouting = FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kRoutingSingle;
+    int fFilterType2 = sst::filters::fut_vintageladder;
+    int fFilterSubType2 = 0;
+    float fFreqNote2 = 12.0f;
+    float fResonance2 = 0.5f;
+    float fFeedback = 0.0f;
+    int fDriveShape = 0;
+    float fDriveDB = 0.0f;
+    int fDrivePosition = FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kDrivePre;
+
+    // latency last reported to the host
+    uint32_t fLatency = 0;
+
+    FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS> fEngine;
+
+    // steps the quality tier down while run() takes too much of the realtime budget, and the tier it runs at
+    LoadGovernor fGovernor;
+    int fActiveQuality = FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kQualityNormal;
+
+#if PLUGIN_RT_LOG
+    // setParameterValue may run on the audio thread, so it never prints directly
+    RtLog fLog;
+#endif
 
 public:
    /**
@@ -74,7 +90,11 @@ public:
     ImGuiPluginDSP()
         : Plugin(kParamCount, 0, 0) // parameters, programs, states
     {
-        FUnit = sst::filters::GetQFPtrFilterUnit(ft, fst);
+        fEngine.setSampleRate(getSampleRate());
+        fEngine.setBackgroundCoeffs(PLUGIN_BACKGROUND_COEFFS != 0);
+        fGovernor.setSampleRate(getSampleRate());
+        fGovernor.setBudget(fCpuBudget * 0.01f);
+        fGovernor.setMaxSteps(fQuality);
     }
 
 protected:
@@ -175,6 +195,286 @@ protected:
             parameter.symbol = "resonance";
             parameter.unit = "";
             break;
+        case 3:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = sst::filters::num_filter_types - 1;
+            parameter.ranges.def = sst::filters::fut_vintageladder;
+            parameter.hints = kParameterIsAutomatable | kParameterIsInteger;
+            parameter.name = "Type";
+            parameter.shortName = "Type";
+            parameter.symbol = "type";
+            parameter.unit = "";
+            break;
+        case 4:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kMaxSubTypeParam;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable | kParameterIsInteger;
+            parameter.name = "Subtype";
+            parameter.shortName = "Subtype";
+            parameter.symbol = "subtype";
+            parameter.unit = "";
+            break;
+        case 5:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 4.0f;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable | kParameterIsInteger;
+            parameter.name = "Oversampling";
+            parameter.shortName = "Oversampling";
+            parameter.symbol = "oversampling";
+            parameter.unit = "";
+            parameter.enumValues.count = 5;
+            parameter.enumValues.restrictedMode = true;
+            {
+                ParameterEnumerationValue* const values = new ParameterEnumerationValue[5];
+                parameter.enumValues.values = values;
+                values[0].label = "Auto";
+                values[0].value = 0.0f;
+                values[1].label = "1x";
+                values[1].value = 1.0f;
+                values[2].label = "2x";
+                values[2].value = 2.0f;
+                values[3].label = "4x";
+                values[3].value = 3.0f;
+                values[4].label = "8x";
+                values[4].value = 4.0f;
+            }
+            break;
+        case 6:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 2.0f;
+            parameter.ranges.def = FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kQualityNormal;
+            parameter.hints = kParameterIsAutomatable | kParameterIsInteger;
+            parameter.name = "Quality";
+            parameter.shortName = "Quality";
+            parameter.symbol = "quality";
+            parameter.unit = "";
+            parameter.enumValues.count = 3;
+            parameter.enumValues.restrictedMode = true;
+            {
+                ParameterEnumerationValue* const values = new ParameterEnumerationValue[3];
+                parameter.enumValues.values = values;
+                values[0].label = "Eco";
+                values[0].value = 0.0f;
+                values[1].label = "Normal";
+                values[1].value = 1.0f;
+                values[2].label = "High";
+                values[2].value = 2.0f;
+            }
+            break;
+        case 7:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 1.0f;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable | kParameterIsBoolean;
+            parameter.name = "Offline render";
+            parameter.shortName = "Offline";
+            parameter.symbol = "offline";
+            parameter.unit = "";
+            break;
+        case 8:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 100.0f;
+            parameter.ranges.def = 75.0f;
+            parameter.hints = kParameterIsAutomatable;
+            parameter.name = "CPU budget";
+            parameter.shortName = "CPU budget";
+            parameter.symbol = "cpubudget";
+            parameter.unit = "%";
+            break;
+        case 9:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 2.0f;
+            parameter.ranges.def = FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kQualityNormal;
+            parameter.hints = kParameterIsOutput | kParameterIsInteger;
+            parameter.name = "Active quality";
+            parameter.shortName = "Active quality";
+            parameter.symbol = "activequality";
+            parameter.unit = "";
+            break;
+        case 10:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 100.0f;
+            parameter.ranges.def = 100.0f;
+            parameter.hints = kParameterIsAutomatable;
+            parameter.name = "Mix";
+            parameter.shortName = "Mix";
+            parameter.symbol = "mix";
+            parameter.unit = "%";
+            break;
+        case 11:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 1.0f;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable | kParameterIsInteger;
+            parameter.name = "Mode";
+            parameter.shortName = "Mode";
+            parameter.symbol = "mode";
+            parameter.unit = "";
+            parameter.enumValues.count = 2;
+            parameter.enumValues.restrictedMode = true;
+            {
+                ParameterEnumerationValue* const values = new ParameterEnumerationValue[2];
+                parameter.enumValues.values = values;
+                values[0].label = "Effect";
+                values[0].value = 0.0f;
+                values[1].label = "Poly";
+                values[1].value = 1.0f;
+            }
+            break;
+        case 12:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 100.0f;
+            parameter.ranges.def = 100.0f;
+            parameter.hints = kParameterIsAutomatable;
+            parameter.name = "Key track";
+            parameter.shortName = "Key track";
+            parameter.symbol = "keytrack";
+            parameter.unit = "%";
+            break;
+        case 13:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 1.0f;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable;
+            parameter.name = "Velocity to resonance";
+            parameter.shortName = "Vel to res";
+            parameter.symbol = "velocitytoresonance";
+            parameter.unit = "";
+            break;
+        case 14:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kRoutingCount - 1;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable | kParameterIsInteger;
+            parameter.name = "Routing";
+            parameter.shortName = "Routing";
+            parameter.symbol = "routing";
+            parameter.unit = "";
+            parameter.enumValues.count = 5;
+            parameter.enumValues.restrictedMode = true;
+            {
+                ParameterEnumerationValue* const values = new ParameterEnumerationValue[5];
+                parameter.enumValues.values = values;
+                values[0].label = "Single";
+                values[0].value = 0.0f;
+                values[1].label = "Serial";
+                values[1].value = 1.0f;
+                values[2].label = "Parallel";
+                values[2].value = 2.0f;
+                values[3].label = "Stereo";
+                values[3].value = 3.0f;
+                values[4].label = "Feedback";
+                values[4].value = 4.0f;
+            }
+            break;
+        case 15:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = sst::filters::num_filter_types - 1;
+            parameter.ranges.def = sst::filters::fut_vintageladder;
+            parameter.hints = kParameterIsAutomatable | kParameterIsInteger;
+            parameter.name = "Type 2";
+            parameter.shortName = "Type 2";
+            parameter.symbol = "type2";
+            parameter.unit = "";
+            break;
+        case 16:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kMaxSubTypeParam;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable | kParameterIsInteger;
+            parameter.name = "Subtype 2";
+            parameter.shortName = "Subtype 2";
+            parameter.symbol = "subtype2";
+            parameter.unit = "";
+            break;
+        case 17:
+            parameter.ranges.min = -60.0f;
+            parameter.ranges.max = 64.0f;
+            parameter.ranges.def = 12.0f;
+            parameter.hints = kParameterIsAutomatable;
+            parameter.name = "FrequencyNote2";
+            parameter.shortName = "FrequencyNote2";
+            parameter.symbol = "frequencynote2";
+            parameter.unit = "";
+            break;
+        case 18:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 1.0f;
+            parameter.ranges.def = 0.5f;
+            parameter.hints = kParameterIsAutomatable;
+            parameter.name = "Resonance2";
+            parameter.shortName = "Resonance2";
+            parameter.symbol = "resonance2";
+            parameter.unit = "";
+            break;
+        case 19:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 100.0f;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable;
+            parameter.name = "Feedback";
+            parameter.shortName = "Feedback";
+            parameter.symbol = "feedback";
+            parameter.unit = "%";
+            break;
+        case 20:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kNumDriveShapes - 1;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable | kParameterIsInteger;
+            parameter.name = "Drive shape";
+            parameter.shortName = "Drive shape";
+            parameter.symbol = "driveshape";
+            parameter.unit = "";
+            parameter.enumValues.count = 5;
+            parameter.enumValues.restrictedMode = true;
+            {
+                ParameterEnumerationValue* const values = new ParameterEnumerationValue[5];
+                parameter.enumValues.values = values;
+                values[0].label = "Off";
+                values[0].value = 0.0f;
+                values[1].label = "Soft clip";
+                values[1].value = 1.0f;
+                values[2].label = "Tanh";
+                values[2].value = 2.0f;
+                values[3].label = "Asymmetric";
+                values[3].value = 3.0f;
+                values[4].label = "Fold";
+                values[4].value = 4.0f;
+            }
+            break;
+        case 21:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 36.0f;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable;
+            parameter.name = "Drive";
+            parameter.shortName = "Drive";
+            parameter.symbol = "drive";
+            parameter.unit = "dB";
+            break;
+        case 22:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kDrivePositionCount - 1;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable | kParameterIsInteger;
+            parameter.name = "Drive position";
+            parameter.shortName = "Drive pos";
+            parameter.symbol = "driveposition";
+            parameter.unit = "";
+            parameter.enumValues.count = 2;
+            parameter.enumValues.restrictedMode = true;
+            {
+                ParameterEnumerationValue* const values = new ParameterEnumerationValue[2];
+                parameter.enumValues.values = values;
+                values[0].label = "Pre";
+                values[0].value = 0.0f;
+                values[1].label = "Between";
+                values[1].value = 1.0f;
+            }
+            break;
         }
     }
 
@@ -194,6 +494,46 @@ protected:
             return fFreqNote;
         case 2:
             return fResonance;
+        case 3:
+            return fFilterType;
+        case 4:
+            return fFilterSubType;
+        case 5:
+            return fOversampling;
+        case 6:
+            return fQuality;
+        case 7:
+            return fOffline ? 1.0f : 0.0f;
+        case 8:
+            return fCpuBudget;
+        case 9:
+            return fActiveQuality;
+        case 10:
+            return fMix;
+        case 11:
+            return fPolyMode ? 1.0f : 0.0f;
+        case 12:
+            return fKeyTrack;
+        case 13:
+            return fVelocityToRes;
+        case 14:
+            return fRouting;
+        case 15:
+            return fFilterType2;
+        case 16:
+            return fFilterSubType2;
+        case 17:
+            return fFreqNote2;
+        case 18:
+            return fResonance2;
+        case 19:
+            return fFeedback;
+        case 20:
+            return fDriveShape;
+        case 21:
+            return fDriveDB;
+        case 22:
+            return fDrivePosition;
         default:
             return 0.0;
         }
@@ -210,15 +550,97 @@ protected:
         switch (index) {
         case 0:
             fGainDB = value;
-            fGainLinear = DB_CO(CLAMP(value, -90.0, 30.0));
+            fEngine.setGainDB(value);
             break;
         case 1:
             fFreqNote = value;
-            d_stdout("New freq note: %f", fFreqNote);
+            fEngine.setFrequencyNote(value);
+            RT_LOG(fLog, "New freq note: %f", fFreqNote);
             break;
         case 2:
             fResonance = value;
-            d_stdout("New resonance: %f", fResonance);
+            fEngine.setResonance(value);
+            RT_LOG(fLog, "New resonance: %f", fResonance);
+            break;
+        case 3:
+            fFilterType = CLAMP((int)value, 0, sst::filters::num_filter_types - 1);
+            fEngine.setFilterType(fFilterType);
+            break;
+        case 4:
+            fFilterSubType = CLAMP((int)value, 0, FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kMaxSubTypeParam);
+            fEngine.setFilterSubType(fFilterSubType);
+            break;
+        case 5:
+            // Auto follows the quality tier
+            fOversampling = CLAMP((int)value, 0, 4);
+            fEngine.setOversampling(fOversampling != 0 ? 1u << (fOversampling - 1) : 0);
+            break;
+        case 6:
+            fQuality = CLAMP((int)value, 0, FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kQualityCount - 1);
+            fGovernor.setMaxSteps(fQuality);
+            updateQuality();
+            break;
+        case 7:
+            fOffline = value > 0.5f;
+            fEngine.setOfflineRendering(fOffline);
+            updateQuality();
+            break;
+        case 8:
+            fCpuBudget = CLAMP(value, 0.0f, 100.0f);
+            fGovernor.setBudget(fCpuBudget * 0.01f);
+            updateQuality();
+            break;
+        case 10:
+            fMix = CLAMP(value, 0.0f, 100.0f);
+            fEngine.setMix(fMix * 0.01f);
+            break;
+        case 11:
+            fPolyMode = value > 0.5f;
+            fEngine.setPolyMode(fPolyMode);
+            break;
+        case 12:
+            fKeyTrack = CLAMP(value, 0.0f, 100.0f);
+            fEngine.setKeyTrack(fKeyTrack * 0.01f);
+            break;
+        case 13:
+            fVelocityToRes = CLAMP(value, 0.0f, 1.0f);
+            fEngine.setVelocityToResonance(fVelocityToRes);
+            break;
+        case 14:
+            fRouting = CLAMP((int)value, 0, FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kRoutingCount - 1);
+            fEngine.setRouting(fRouting);
+            break;
+        case 15:
+            fFilterType2 = CLAMP((int)value, 0, sst::filters::num_filter_types - 1);
+            fEngine.setFilterType(fFilterType2, 1);
+            break;
+        case 16:
+            fFilterSubType2 = CLAMP((int)value, 0, FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kMaxSubTypeParam);
+            fEngine.setFilterSubType(fFilterSubType2, 1);
+            break;
+        case 17:
+            fFreqNote2 = value;
+            fEngine.setFrequencyNote(value, 1);
+            break;
+        case 18:
+            fResonance2 = value;
+            fEngine.setResonance(value, 1);
+            break;
+        case 19:
+            fFeedback = CLAMP(value, 0.0f, 100.0f);
+            fEngine.setFeedback(fFeedback * 0.01f);
+            break;
+        case 20:
+            fDriveShape = CLAMP((int)value, 0, FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kNumDriveShapes - 1);
+            fEngine.setDriveShape(fDriveShape);
+            break;
+        case 21:
+            fDriveDB = CLAMP(value, 0.0f, 36.0f);
+            fEngine.setDriveDB(fDriveDB);
+            break;
+        case 22:
+            fDrivePosition = CLAMP((int)value, 0, FilterEngine<DISTRHO_PLUGIN_NUM_INPUTS>::kDrivePositionCount - 1);
+            fEngine.setDrivePosition(fDrivePosition);
             break;
         }
     }
@@ -226,67 +648,66 @@ protected:
     // ----------------------------------------------------------------------------------------------------------------
     // Audio/MIDI Processing
 
-    void resetFilterRegisters()
-    {
-        coeffMaker.Reset();
-        std::fill(filterState.R, &filterState.R[sst::filters::n_filter_registers], _mm_setzero_ps());
-        std::fill(filterState.C, &filterState.C[sst::filters::n_cm_coeffs], _mm_setzero_ps());
-        for (int i = 0; i < 4; ++i)
-        {
-            filterState.WP[i] = 0;
-            filterState.active[i] = 0xFFFFFFFF;
-            filterState.DB[i] = &(delayBuffer[i][0]);
-        }
-    }
-
    /**
       Activate this plugin.
     */
     void activate() override
     {
-        fSmoothGain->flush();
-        resetFilterRegisters();
-        coeffMaker.setSampleRateAndBlockSize((float)getSampleRate(), getBufferSize());
-        coeffMaker.MakeCoeffs(fFreqNote, fResonance, ft, fst, nullptr, false);
-        coeffMaker.updateState(filterState);
+        fGovernor.reset();
+        updateQuality();
+        fEngine.activate();
+        fActiveQuality = fEngine.getActiveQuality();
+
+        fLatency = fEngine.getLatency();
+        setLatency(fLatency);
     }
 
    /**
-      Run/process function for plugins without MIDI input.
+      Run/process function for plugins with MIDI input.
       @note Some parameters might be null if there are no audio inputs or outputs.
     */
-    void run(const float** inputs, float** outputs, uint32_t frames) override
-    {   
-        // get the left and right audio inputs
-        const float* const inpL = inputs[0];
-        const float* const inpR = inputs[1];
-
-        // get the left and right audio outputs
-        float* const outL = outputs[0];
-        float* const outR = outputs[1];
+    void run(const float** inputs, float** outputs, uint32_t frames,
+             const MidiEvent* midiEvents, uint32_t midiEventCount) override
+    {
+        const LoadGovernor::Clock::time_point start = LoadGovernor::Clock::now();
 
-        for (int f = 0; f < sst::filters::n_cm_coeffs; ++f)
+        // notes start and stop on their frame, the block is split around them
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i <= midiEventCount; ++i)
         {
-            coeffMaker.C[f] = filterState.C[f][0];
+            const uint32_t end = i < midiEventCount ? MIN(midiEvents[i].frame, frames) : frames;
+
+            if (end > offset)
+            {
+                const float* ins[DISTRHO_PLUGIN_NUM_INPUTS];
+                float* outs[DISTRHO_PLUGIN_NUM_OUTPUTS];
+                for (uint32_t c = 0; c < DISTRHO_PLUGIN_NUM_INPUTS; ++c)
+                {
+                    ins[c] = inputs[c] + offset;
+                    outs[c] = outputs[c] + offset;
+                }
+
+                fEngine.process(ins, outs, end - offset);
+                offset = end;
+            }
+
+            if (i < midiEventCount)
+                handleMidiEvent(midiEvents[i]);
         }
-        coeffMaker.MakeCoeffs(fFreqNote, fResonance, ft, fst, nullptr, false);
-        coeffMaker.updateState(filterState);
-
-        for (uint32_t i=0; i < frames; ++i)
-        {   
-            auto filt = FUnit(&filterState, _mm_loadu_ps(&inpL[i]));
 
-            const float gain = fSmoothGain->process(fGainLinear);
-            auto post = _mm_mul_ps(filt, _mm_set_ps1(gain));
-            _mm_storeu_ps(&outL[i], post);
-            outR[i] = inpL[i] * gain;
+        // offline rendering has no deadline to keep
+        if (! fOffline && fGovernor.update(start, LoadGovernor::Clock::now(), frames))
+            updateQuality();
 
-            // auto yVec = FUnit(&filterState, _mm_set_ps1(inpL[i]));
+        // the engine only moves to a lower tier once its filters run at that tier's oversampling factor
+        fActiveQuality = fEngine.getActiveQuality();
 
-            // float yArr alignas(16)[4];
-            // _mm_store_ps (yArr, yVec);
-
-            // outL[i] = yArr[0] * gain; // out L is filtered
+        // the latency follows the Oversampling, Quality and Offline parameters, the governor never changes it since the
+        // engine delays filters it runs at a lower factor up to it
+        if (fEngine.getLatency() != fLatency)
+        {
+            fLatency = fEngine.getLatency();
+            setLatency(fLatency);
         }
     }
 
@@ -300,10 +721,43 @@ protected:
     */
     void sampleRateChanged(double newSampleRate) override
     {
-        fSampleRate = newSampleRate;
-        fSmoothGain->setSampleRate(newSampleRate);
-        resetFilterRegisters();
-        coeffMaker.setSampleRateAndBlockSize((float)getSampleRate(), getBufferSize());
+        fEngine.setSampleRate(newSampleRate);
+        fGovernor.setSampleRate(newSampleRate);
+    }
+
+    // ----------------------------------------------------------------------------------------------------------------
+
+   /**
+      Pass note on and off, and the all notes off and all sound off controllers, to the voices of the synth-filter mode.
+    */
+    void handleMidiEvent(const MidiEvent& event)
+    {
+        if (event.size > MidiEvent::kDataSize)
+            return;
+
+        const uint8_t status = event.data[0] & 0xF0;
+
+        switch (status) {
+        case 0x90:
+            fEngine.noteOn(event.data[1], event.data[2]);
+            break;
+        case 0x80:
+            fEngine.noteOff(event.data[1]);
+            break;
+        case 0xB0:
+            if (event.data[1] == 120 || event.data[1] == 123)
+                fEngine.allNotesOff();
+            break;
+        }
+    }
+
+   /**
+      Run the engine at the selected quality tier, lowered by the steps the governor took down.
+    */
+    void updateQuality()
+    {
+        fEngine.setQuality(fQuality);
+        fEngine.setQualityReduction(fGovernor.getSteps());
     }
 
     // ----------------------------------------------------------------------------------------------------------------
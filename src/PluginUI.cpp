@@ -8,15 +8,62 @@
 #include "DistrhoUI.hpp"
 #include "ResizeHandle.hpp"
 
+#include <algorithm>
+
+#include <sst/filters.h>
+
 START_NAMESPACE_DISTRHO
 
 // --------------------------------------------------------------------------------------------------------------------
 
+/**
+   Entry @a index of @a labels, with the index clamped to the array.
+   Choice parameters arrive from the host as plain floats, so the index is not guaranteed to be in range.
+ */
+template <size_t N>
+static const char* choiceLabel(const char* const (&labels)[N], int index)
+{
+    return labels[index < 0 ? 0 : index >= (int)N ? (int)N - 1 : index];
+}
+
+/**
+   Highest subtype sst provides for filter @a type, 0 for types without subtypes.
+   The DSP side clamps the subtype parameter to the same range.
+ */
+static int maxSubType(int type)
+{
+    if (type < 0 || type >= sst::filters::num_filter_types)
+        return 0;
+
+    return std::max(sst::filters::fut_subcount[type], 1) - 1;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
 class ImGuiPluginUI : public UI
 {
     float fGain = 0.0f;
     float fFreqNote = -12.0f;
     float fResonance = 0.5f;
+    int fFilterType = sst::filters::fut_vintageladder;
+    int fFilterSubType = 0;
+    int fOversampling = 0;
+    int fQuality = 1;
+    float fCpuBudget = 75.0f;
+    int fActiveQuality = 1;
+    float fMix = 100.0f;
+    int fPolyMode = 0;
+    float fKeyTrack = 100.0f;
+    float fVelocityToRes = 0.0f;
+    int fRouting = 0;
+    int fFilterType2 = sst::filters::fut_vintageladder;
+    int fFilterSubType2 = 0;
+    float fFreqNote2 = 12.0f;
+    float fResonance2 = 0.5f;
+    float fFeedback = 0.0f;
+    int fDriveShape = 0;
+    float fDriveDB = 0.0f;
+    int fDrivePosition = 0;
     ResizeHandle fResizeHandle;
 
     // ----------------------------------------------------------------------------------------------------------------
@@ -57,6 +104,63 @@ protected:
         case 2:
             fResonance = value;
             break;
+        case 3:
+            fFilterType = (int)value;
+            break;
+        case 4:
+            fFilterSubType = (int)value;
+            break;
+        case 5:
+            fOversampling = (int)value;
+            break;
+        case 6:
+            fQuality = (int)value;
+            break;
+        case 8:
+            fCpuBudget = value;
+            break;
+        case 9:
+            fActiveQuality = (int)value;
+            break;
+        case 10:
+            fMix = value;
+            break;
+        case 11:
+            fPolyMode = (int)value;
+            break;
+        case 12:
+            fKeyTrack = value;
+            break;
+        case 13:
+            fVelocityToRes = value;
+            break;
+        case 14:
+            fRouting = (int)value;
+            break;
+        case 15:
+            fFilterType2 = (int)value;
+            break;
+        case 16:
+            fFilterSubType2 = (int)value;
+            break;
+        case 17:
+            fFreqNote2 = value;
+            break;
+        case 18:
+            fResonance2 = value;
+            break;
+        case 19:
+            fFeedback = value;
+            break;
+        case 20:
+            fDriveShape = (int)value;
+            break;
+        case 21:
+            fDriveDB = value;
+            break;
+        case 22:
+            fDrivePosition = (int)value;
+            break;
         }
         repaint();
     }
@@ -110,6 +214,229 @@ protected:
                 editParameter(0, false);
                 editParameter(1, false);
             }
+
+            if (ImGui::SliderInt("Type", &fFilterType, 0, sst::filters::num_filter_types - 1))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(3, true);
+
+                setParameterValue(3, fFilterType);
+
+                if (fFilterSubType > maxSubType(fFilterType))
+                {
+                    fFilterSubType = maxSubType(fFilterType);
+                    editParameter(4, true);
+                    setParameterValue(4, fFilterSubType);
+                    editParameter(4, false);
+                }
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(3, false);
+
+            if (ImGui::SliderInt("Subtype", &fFilterSubType, 0, maxSubType(fFilterType)))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(4, true);
+
+                setParameterValue(4, fFilterSubType);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(4, false);
+
+            if (ImGui::SliderFloat("Mix (%)", &fMix, 0.0f, 100.0f))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(10, true);
+
+                setParameterValue(10, fMix);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(10, false);
+
+            static const char* const routingLabels[] = { "Single", "Serial", "Parallel", "Stereo", "Feedback" };
+            if (ImGui::SliderInt("Routing", &fRouting, 0, 4, choiceLabel(routingLabels, fRouting)))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(14, true);
+
+                setParameterValue(14, fRouting);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(14, false);
+
+            if (ImGui::SliderFloat("Frequency note 2", &fFreqNote2, -60.0f, 64.0f))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(17, true);
+
+                setParameterValue(17, fFreqNote2);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(17, false);
+
+            if (ImGui::SliderFloat("Resonance 2", &fResonance2, 0.0f, 1.0f))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(18, true);
+
+                setParameterValue(18, fResonance2);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(18, false);
+
+            if (ImGui::SliderInt("Type 2", &fFilterType2, 0, sst::filters::num_filter_types - 1))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(15, true);
+
+                setParameterValue(15, fFilterType2);
+
+                if (fFilterSubType2 > maxSubType(fFilterType2))
+                {
+                    fFilterSubType2 = maxSubType(fFilterType2);
+                    editParameter(16, true);
+                    setParameterValue(16, fFilterSubType2);
+                    editParameter(16, false);
+                }
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(15, false);
+
+            if (ImGui::SliderInt("Subtype 2", &fFilterSubType2, 0, maxSubType(fFilterType2)))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(16, true);
+
+                setParameterValue(16, fFilterSubType2);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(16, false);
+
+            if (ImGui::SliderFloat("Feedback (%)", &fFeedback, 0.0f, 100.0f))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(19, true);
+
+                setParameterValue(19, fFeedback);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(19, false);
+
+            static const char* const driveShapeLabels[] = { "Off", "Soft clip", "Tanh", "Asymmetric", "Fold" };
+            if (ImGui::SliderInt("Drive shape", &fDriveShape, 0, 4, choiceLabel(driveShapeLabels, fDriveShape)))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(20, true);
+
+                setParameterValue(20, fDriveShape);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(20, false);
+
+            if (ImGui::SliderFloat("Drive (dB)", &fDriveDB, 0.0f, 36.0f))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(21, true);
+
+                setParameterValue(21, fDriveDB);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(21, false);
+
+            static const char* const drivePositionLabels[] = { "Pre", "Between" };
+            if (ImGui::SliderInt("Drive position", &fDrivePosition, 0, 1,
+                                 choiceLabel(drivePositionLabels, fDrivePosition)))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(22, true);
+
+                setParameterValue(22, fDrivePosition);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(22, false);
+
+            static const char* const modeLabels[] = { "Effect", "Poly" };
+            if (ImGui::SliderInt("Mode", &fPolyMode, 0, 1, choiceLabel(modeLabels, fPolyMode)))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(11, true);
+
+                setParameterValue(11, fPolyMode);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(11, false);
+
+            if (ImGui::SliderFloat("Key track (%)", &fKeyTrack, 0.0f, 100.0f))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(12, true);
+
+                setParameterValue(12, fKeyTrack);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(12, false);
+
+            if (ImGui::SliderFloat("Velocity to resonance", &fVelocityToRes, 0.0f, 1.0f))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(13, true);
+
+                setParameterValue(13, fVelocityToRes);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(13, false);
+
+            static const char* const oversamplingLabels[] = { "Auto", "1x", "2x", "4x", "8x" };
+            if (ImGui::SliderInt("Oversampling", &fOversampling, 0, 4, choiceLabel(oversamplingLabels, fOversampling)))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(5, true);
+
+                setParameterValue(5, fOversampling);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(5, false);
+
+            static const char* const qualityLabels[] = { "Eco", "Normal", "High" };
+            if (ImGui::SliderInt("Quality", &fQuality, 0, 2, choiceLabel(qualityLabels, fQuality)))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(6, true);
+
+                setParameterValue(6, fQuality);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(6, false);
+
+            if (ImGui::SliderFloat("CPU budget (%)", &fCpuBudget, 0.0f, 100.0f))
+            {
+                if (ImGui::IsItemActivated())
+                    editParameter(8, true);
+
+                setParameterValue(8, fCpuBudget);
+            }
+
+            if (ImGui::IsItemDeactivated())
+                editParameter(8, false);
+
+            ImGui::Text("Running at %s quality", choiceLabel(qualityLabels, fActiveQuality));
         }
         ImGui::End();
     }
@@ -0,0 +1,144 @@
+/**
+ * Realtime-safe logging.
+ *
+ * Messages are pushed into a lock-free multi-producer/single-consumer ring buffer without allocating,
+ * locking or formatting, and a background thread formats and prints them with d_stdout.
+ * Parameters are set from the host and UI threads as well as the audio thread, so producers claim a slot with a
+ * compare-and-swap on the write position, and every slot carries a sequence number telling whether it is free,
+ * being written or ready to print.
+ * A message is a format string literal and one float argument, when the ring is full new messages are dropped.
+ *
+ * Logging is compiled in when PLUGIN_RT_LOG is 1, which is the default for builds without NDEBUG.
+ * With it set to 0 the RT_LOG macro expands to nothing and no thread is started.
+ */
+
+#ifndef RT_LOG_H
+#define RT_LOG_H
+
+#ifndef PLUGIN_RT_LOG
+# ifdef NDEBUG
+#  define PLUGIN_RT_LOG 0
+# else
+#  define PLUGIN_RT_LOG 1
+# endif
+#endif
+
+#if PLUGIN_RT_LOG
+
+#include "DistrhoUtils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+START_NAMESPACE_DISTRHO
+
+class RtLog {
+public:
+    RtLog()
+    {
+        for (uint32_t i = 0; i < kSize; ++i)
+            entries[i].sequence.store(i, std::memory_order_relaxed);
+
+        thread = std::thread([this] { run(); });
+    }
+
+    ~RtLog()
+    {
+        running = false;
+        thread.join();
+        drain();
+    }
+
+   /**
+      Queue a message, safe to call from the realtime thread and from any number of other threads at once.
+      @a format must be a string literal, or otherwise outlive the log.
+    */
+    bool push(const char* format, float value) noexcept
+    {
+        uint32_t pos = tail.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            Entry& entry = entries[pos & kMask];
+            const int32_t lag = (int32_t)(entry.sequence.load(std::memory_order_acquire) - pos);
+
+            if (lag < 0)
+                return false;
+
+            if (lag > 0)
+            {
+                // another producer claimed this slot first
+                pos = tail.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                entry.format = format;
+                entry.value = value;
+                entry.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+    }
+
+   /**
+      Print every queued message, must only be called from the consumer thread.
+      Stops at a slot that has been claimed but not written yet, the rest is printed on the next call.
+    */
+    void drain()
+    {
+        for (;;)
+        {
+            Entry& entry = entries[head & kMask];
+
+            if (entry.sequence.load(std::memory_order_acquire) != head + 1)
+                return;
+
+            d_stdout(entry.format, entry.value);
+            entry.sequence.store(head + kSize, std::memory_order_release);
+            ++head;
+        }
+    }
+
+private:
+    static constexpr uint32_t kSize = 256;
+    static constexpr uint32_t kMask = kSize - 1;
+
+    struct Entry {
+        // pos while free for the producer at pos, pos + 1 once written, pos + kSize once printed
+        std::atomic<uint32_t> sequence;
+        const char* format;
+        float value;
+    };
+
+    Entry entries[kSize];
+    // only touched by the consumer
+    uint32_t head = 0;
+    std::atomic<uint32_t> tail = { 0 };
+    std::atomic<bool> running = { true };
+    std::thread thread;
+
+    void run()
+    {
+        while (running)
+        {
+            drain();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+};
+
+END_NAMESPACE_DISTRHO
+
+#define RT_LOG(log, format, value) (log).push(format, value)
+
+#else
+
+#define RT_LOG(log, format, value) ((void)0)
+
+#endif  // PLUGIN_RT_LOG
+
+#endif  // #ifndef RT_LOG_H
@@ -0,0 +1,102 @@
+/**
+ * Flush denormals to zero for the lifetime of a scope.
+ *
+ * Decaying filter registers eventually reach denormal values, which x86 handles in microcode at many times the
+ * cost of a normal operation. Setting FTZ (results flushed to zero) and DAZ (inputs treated as zero) in MXCSR
+ * avoids that, and restoring the previous MXCSR on exit leaves the host's own floating point mode alone.
+ * ARM gets the same from the FZ bit of FPCR (AArch64) or FPSCR (32-bit VFP). Elsewhere this does nothing, and
+ * the engine's clearing of decayed register lanes is what keeps denormals out of the filters.
+ */
+
+#ifndef SCOPED_DENORMALS_H
+#define SCOPED_DENORMALS_H
+
+#include "SimdSetup.hpp"
+
+#include <stdint.h>
+
+class ScopedDenormals {
+public:
+    ScopedDenormals() noexcept
+        : fSaved(getMode())
+    {
+        setMode(fSaved | kFlushModes);
+    }
+
+    ~ScopedDenormals() noexcept
+    {
+        setMode(fSaved);
+    }
+
+private:
+#if SIMD_NATIVE_SSE
+    typedef uint32_t Mode;
+
+    // FTZ and DAZ
+    static constexpr Mode kFlushModes = 0x8000 | 0x0040;
+
+    static Mode getMode() noexcept
+    {
+        return _mm_getcsr();
+    }
+
+    static void setMode(Mode mode) noexcept
+    {
+        _mm_setcsr(mode);
+    }
+#elif defined(__GNUC__) && defined(__aarch64__)
+    typedef uint64_t Mode;
+
+    // FZ
+    static constexpr Mode kFlushModes = 1u << 24;
+
+    static Mode getMode() noexcept
+    {
+        Mode mode;
+        __asm__ __volatile__("mrs %0, fpcr" : "=r"(mode));
+        return mode;
+    }
+
+    static void setMode(Mode mode) noexcept
+    {
+        __asm__ __volatile__("msr fpcr, %0" : : "r"(mode));
+    }
+#elif defined(__GNUC__) && defined(__arm__) && defined(__ARM_FP)
+    typedef uint32_t Mode;
+
+    // FZ
+    static constexpr Mode kFlushModes = 1u << 24;
+
+    static Mode getMode() noexcept
+    {
+        Mode mode;
+        __asm__ __volatile__("vmrs %0, fpscr" : "=r"(mode));
+        return mode;
+    }
+
+    static void setMode(Mode mode) noexcept
+    {
+        __asm__ __volatile__("vmsr fpscr, %0" : : "r"(mode));
+    }
+#else
+    typedef uint32_t Mode;
+
+    static constexpr Mode kFlushModes = 0;
+
+    static Mode getMode() noexcept
+    {
+        return 0;
+    }
+
+    static void setMode(Mode) noexcept
+    {
+    }
+#endif
+
+    const Mode fSaved;
+
+    ScopedDenormals(const ScopedDenormals&) = delete;
+    ScopedDenormals& operator=(const ScopedDenormals&) = delete;
+};
+
+#endif  // #ifndef SCOPED_DENORMALS_H
@@ -0,0 +1,25 @@
+/**
+ * SSE types and intrinsics on every platform the plugin builds for.
+ *
+ * x86 with SSE2 gets them straight from the compiler. Everywhere else (ARM, RISC-V, x86 built without SSE2) they
+ * come from simde, the same way sst-filters gets the __m128 it builds its quad filter units on, so the simde include
+ * path already arrives through the sst-filters target. simde maps the calls to NEON where there is NEON and to
+ * plain C otherwise, which lets the lane code stay written against one instruction set.
+ * Code that needs the real x86 instruction set (CPU dispatch, MXCSR) checks SIMD_NATIVE_SSE first.
+ */
+
+#ifndef SIMD_SETUP_H
+#define SIMD_SETUP_H
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_NATIVE_SSE 1
+#include <emmintrin.h>
+#else
+#define SIMD_NATIVE_SSE 0
+#ifndef SIMDE_ENABLE_NATIVE_ALIASES
+#define SIMDE_ENABLE_NATIVE_ALIASES
+#endif
+#include <simde/x86/sse2.h>
+#endif
+
+#endif  // #ifndef SIMD_SETUP_H
@@ -0,0 +1,209 @@
+/**
+ * Bank of parameter smoothers, one per lane of an SSE register.
+ *
+ * Up to four continuous parameters are smoothed side by side and a whole block of smoothed values is produced
+ * in one vectorized pass, one row of four values per frame. Every lane has its own ramp shape:
+ *  - one-pole, the classic exponential glide, which never quite arrives
+ *  - linear, a straight ramp over the smoothing time
+ *  - S-curve, a smoothstep over the smoothing time that starts and ends with zero slope
+ * The coefficients are computed by constexpr functions, so they fold away for constant times and rates.
+ */
+
+#ifndef SMOOTHER_BANK_H
+#define SMOOTHER_BANK_H
+
+#include "SimdSetup.hpp"
+
+#include <cstring>
+#include <stdint.h>
+
+class SmootherBank {
+public:
+    static constexpr uint32_t kNumLanes = 4;
+
+    enum Shape {
+        kShapeOnePole = 0,
+        kShapeLinear,
+        kShapeSCurve
+    };
+
+   /**
+      Coefficient of a one-pole smoother with a time constant of @a ms at @a sampleRate.@n
+      https://www.musicdsp.org/en/latest/Filters/257-1-pole-lpf-for-smooth-parameter-changes.html
+    */
+    static constexpr float onePoleCoefficient(double ms, double sampleRate)
+    {
+        return (float)constexprExp(-2.0 * 3.14159265358979323846 / (ms * 0.001 * sampleRate));
+    }
+
+   /**
+      Progress per frame of a ramp lasting @a ms at @a sampleRate.
+    */
+    static constexpr float rampStep(double ms, double sampleRate)
+    {
+        return ms * 0.001 * sampleRate > 1.0 ? (float)(1.0 / (ms * 0.001 * sampleRate)) : 1.0f;
+    }
+
+    SmootherBank()
+    {
+        for (uint32_t l = 0; l < kNumLanes; ++l)
+        {
+            fValue[l] = fStart[l] = fTarget[l] = 0.0f;
+            fProgress[l] = 1.0f;
+        }
+        updateCoefficients();
+    }
+
+   /**
+      Set the shape and smoothing time of @a lane.
+    */
+    void setShape(uint32_t lane, Shape shape, float ms) noexcept
+    {
+        fShape[lane] = shape;
+        fTimeMs[lane] = ms;
+        updateCoefficients();
+    }
+
+    void setSampleRate(double sampleRate) noexcept
+    {
+        fSampleRate = sampleRate;
+        updateCoefficients();
+    }
+
+   /**
+      Glide @a lane from where it is now towards @a target.
+    */
+    void setTarget(uint32_t lane, float target) noexcept
+    {
+        if (target == fTarget[lane])
+            return;
+
+        fStart[lane] = fValue[lane];
+        fTarget[lane] = target;
+        fProgress[lane] = 0.0f;
+    }
+
+    float getTarget(uint32_t lane) const noexcept
+    {
+        return fTarget[lane];
+    }
+
+   /**
+      Jump @a lane to @a value right away, and glide from there towards the current target.
+    */
+    void reset(uint32_t lane, float value) noexcept
+    {
+        fValue[lane] = fStart[lane] = value;
+        fProgress[lane] = value == fTarget[lane] ? 1.0f : 0.0f;
+    }
+
+   /**
+      Jump every lane to its target.
+    */
+    void snap() noexcept
+    {
+        for (uint32_t l = 0; l < kNumLanes; ++l)
+        {
+            fValue[l] = fStart[l] = fTarget[l];
+            fProgress[l] = 1.0f;
+        }
+    }
+
+   /**
+      Advance every lane by @a frames frames and write the smoothed values of each frame to @a rows,
+      one row of kNumLanes floats per frame. @a rows must be 16-byte aligned.
+    */
+    void process(float* rows, uint32_t frames) noexcept
+    {
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 three = _mm_set1_ps(3.0f);
+
+        const __m128 target = _mm_load_ps(fTarget);
+        const __m128 start = _mm_load_ps(fStart);
+        const __m128 span = _mm_sub_ps(target, start);
+        const __m128 a = _mm_load_ps(fPoleA);
+        const __m128 b = _mm_load_ps(fPoleB);
+        const __m128 step = _mm_load_ps(fStep);
+        const __m128 onePoleMask = _mm_load_ps(fOnePoleMask);
+        const __m128 sCurveMask = _mm_load_ps(fSCurveMask);
+
+        __m128 value = _mm_load_ps(fValue);
+        __m128 progress = _mm_load_ps(fProgress);
+
+        for (uint32_t i = 0; i < frames; ++i, rows += kNumLanes)
+        {
+            progress = _mm_min_ps(_mm_add_ps(progress, step), one);
+
+            // p for linear lanes, p^2 (3 - 2p) for S-curve ones
+            const __m128 smooth = _mm_mul_ps(_mm_mul_ps(progress, progress),
+                                             _mm_sub_ps(three, _mm_mul_ps(two, progress)));
+            const __m128 shape = _mm_or_ps(_mm_and_ps(sCurveMask, smooth), _mm_andnot_ps(sCurveMask, progress));
+            const __m128 ramp = _mm_add_ps(start, _mm_mul_ps(span, shape));
+
+            const __m128 pole = _mm_add_ps(_mm_mul_ps(target, b), _mm_mul_ps(value, a));
+
+            value = _mm_or_ps(_mm_and_ps(onePoleMask, pole), _mm_andnot_ps(onePoleMask, ramp));
+            _mm_store_ps(rows, value);
+        }
+
+        _mm_store_ps(fValue, value);
+        _mm_store_ps(fProgress, progress);
+    }
+
+private:
+    double fSampleRate = 44100.0;
+    Shape fShape[kNumLanes] = { kShapeOnePole, kShapeOnePole, kShapeOnePole, kShapeOnePole };
+    float fTimeMs[kNumLanes] = { 20.0f, 20.0f, 20.0f, 20.0f };
+
+    float fValue alignas(16)[kNumLanes];
+    float fStart alignas(16)[kNumLanes];
+    float fTarget alignas(16)[kNumLanes];
+    float fProgress alignas(16)[kNumLanes];
+
+    // one-pole lanes compute target * b + value * a, ramps advance their progress by fStep per frame
+    float fPoleA alignas(16)[kNumLanes];
+    float fPoleB alignas(16)[kNumLanes];
+    float fStep alignas(16)[kNumLanes];
+    float fOnePoleMask alignas(16)[kNumLanes];
+    float fSCurveMask alignas(16)[kNumLanes];
+
+    void updateCoefficients() noexcept
+    {
+        for (uint32_t l = 0; l < kNumLanes; ++l)
+        {
+            fPoleA[l] = onePoleCoefficient(fTimeMs[l], fSampleRate);
+            fPoleB[l] = 1.0f - fPoleA[l];
+            fStep[l] = rampStep(fTimeMs[l], fSampleRate);
+            fOnePoleMask[l] = maskFloat(fShape[l] == kShapeOnePole);
+            fSCurveMask[l] = maskFloat(fShape[l] == kShapeSCurve);
+        }
+    }
+
+    static float maskFloat(bool set) noexcept
+    {
+        const uint32_t bits = set ? 0xFFFFFFFFu : 0u;
+        float mask;
+        std::memcpy(&mask, &bits, sizeof(mask));
+        return mask;
+    }
+
+   /**
+      e^x for x <= 0, by squaring a Taylor series of e^(x / 2^16).
+    */
+    static constexpr double constexprExp(double x)
+    {
+        double r = x / 65536.0;
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 12; ++k)
+        {
+            term *= r / k;
+            sum += term;
+        }
+        for (int k = 0; k < 16; ++k)
+            sum *= sum;
+        return sum;
+    }
+};
+
+#endif  // #ifndef SMOOTHER_BANK_H
@@ -0,0 +1,646 @@
+/**
+ * Polyphonic voices for the synth-filter mode.
+ *
+ * Every voice takes one lane of a quad filter state per channel, with its own key-tracked cutoff, velocity-mapped
+ * resonance and active[] flag, and voice v owns the NumChannels lanes from v * NumChannels on, so the lanes of all
+ * voices and channels are packed four to a state. A single voice of a stereo plugin fills half a state instead of a
+ * whole one per channel, two of them fill it. New notes take the lowest free voice and, when a voice is freed, the
+ * ones above it move down into the gap, so the sounding voices stay packed into as few states as possible and states
+ * without a sounding lane are not run at all.
+ * Once every voice is taken the quietest released voice, or else the oldest held one, is stolen.
+ */
+
+#ifndef VOICE_BANK_H
+#define VOICE_BANK_H
+
+#include "CoeffCache.hpp"
+#include "FilterKernels.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+#include <sst/filters.h>
+
+template <uint32_t NumChannels, uint32_t MaxFrames>
+class VoiceBank {
+public:
+    static constexpr uint32_t kMaxVoices = 16;
+    static constexpr uint32_t kMaxLanes = (kMaxVoices * NumChannels + 3) / 4 * 4;
+
+    VoiceBank()
+    {
+        setPolyphony(8);
+    }
+
+   /**
+      Set the number of voices, 1 to kMaxVoices, and silence them all.@n
+      Allocates the filter states for one lane per voice and channel, so only while the engine is deactivated.
+    */
+    void setPolyphony(uint32_t voices)
+    {
+        fNumVoices = voices < 1 ? 1 : voices > kMaxVoices ? kMaxVoices : voices;
+        fGroups.resize((fNumVoices * NumChannels + 3) / 4);
+        reset();
+    }
+
+    uint32_t getPolyphony() const noexcept
+    {
+        return fNumVoices;
+    }
+
+   /**
+      Set the rate the filters run at, and how many of their samples a control sub-block has.
+    */
+    void setRate(float rate, uint32_t blockSize)
+    {
+        fRate = rate;
+        fBlockSize = blockSize;
+        fAttackStep = 1.0f / std::fmax(1.0f, kAttackMs * 0.001f * rate);
+        fReleaseStep = -1.0f / std::fmax(1.0f, kReleaseMs * 0.001f * rate);
+
+        for (uint32_t v = 0; v < kMaxVoices; ++v)
+        {
+            Voice& voice = fVoices[v];
+            voice.coeffMaker.setSampleRateAndBlockSize(rate, blockSize);
+            voice.coeffsSettling = voice.allocated;
+            if (voice.allocated)
+                setLevelStep(v, voice.held ? fAttackStep : fReleaseStep);
+        }
+    }
+
+   /**
+      Run the voices through @a type and @a subType, restarting their filters if that is a change.
+    */
+    void setFilter(sst::filters::FilterType type, sst::filters::FilterSubType subType)
+    {
+        if (type == fType && subType == fSubType)
+            return;
+
+        fType = type;
+        fSubType = subType;
+        fUnit = sst::filters::GetQFPtrFilterUnit(type, subType);
+        fKernel = FilterKernels::get(type, subType);
+
+        resetGroups();
+        for (Voice& voice : fVoices)
+        {
+            voice.coeffMaker.Reset();
+            voice.coeffsSettling = voice.allocated;
+        }
+    }
+
+    sst::filters::FilterType getFilterType() const noexcept
+    {
+        return fType;
+    }
+
+    sst::filters::FilterSubType getFilterSubType() const noexcept
+    {
+        return fSubType;
+    }
+
+   /**
+      Silence every voice and clear every filter state.
+    */
+    void reset()
+    {
+        for (uint32_t v = 0; v < kMaxVoices; ++v)
+        {
+            fVoices[v] = Voice();
+            fVoices[v].coeffMaker.setSampleRateAndBlockSize(fRate, fBlockSize);
+        }
+
+        for (uint32_t l = 0; l < kMaxLanes; ++l)
+        {
+            fLevel[l] = 0.0f;
+            fLevelStep[l] = 0.0f;
+        }
+
+        resetGroups();
+    }
+
+   /**
+      Start a voice for MIDI note @a key at @a velocity, 0 to 1, stealing one if they are all taken.
+    */
+    void noteOn(uint8_t key, float velocity)
+    {
+        uint32_t v = findVoice(key);
+
+        if (v == kMaxVoices)
+        {
+            v = findFreeVoice();
+            if (v == kMaxVoices)
+                v = findVoiceToSteal();
+
+            // a new or stolen voice starts from silence, with its coefficients right on target
+            for (uint32_t lane = v * NumChannels; lane < (v + 1) * NumChannels; ++lane)
+            {
+                sst::filters::QuadFilterUnitState& state = laneState(lane);
+                FilterKernels::resetLane(state, lane % 4);
+                state.active[lane % 4] = 0xFFFFFFFF;
+                fLevel[lane] = 0.0f;
+            }
+            fVoices[v].coeffMaker.Reset();
+        }
+
+        Voice& voice = fVoices[v];
+        voice.key = key;
+        voice.velocity = velocity;
+        voice.allocated = true;
+        voice.held = true;
+        voice.order = ++fNoteCounter;
+        voice.coeffsSettling = true;
+        voice.coeffsNeedFreeze = false;
+        setLevelStep(v, fAttackStep);
+    }
+
+   /**
+      Release the voice playing MIDI note @a key, it fades out over kReleaseMs while its filter keeps ringing.
+    */
+    void noteOff(uint8_t key)
+    {
+        const uint32_t v = findVoice(key);
+        if (v == kMaxVoices || ! fVoices[v].held)
+            return;
+
+        fVoices[v].held = false;
+        setLevelStep(v, fReleaseStep);
+    }
+
+    void allNotesOff()
+    {
+        for (uint32_t v = 0; v < fNumVoices; ++v)
+        {
+            if (fVoices[v].held)
+                noteOff(fVoices[v].key);
+        }
+    }
+
+   /**
+      Free every released voice right away, for when nothing is heard of their fade out anyway.
+    */
+    void freeReleasedVoices()
+    {
+        bool freed = false;
+        for (uint32_t v = 0; v < fNumVoices; ++v)
+        {
+            if (fVoices[v].allocated && ! fVoices[v].held)
+            {
+                freeVoice(v);
+                freed = true;
+            }
+        }
+
+        if (freed)
+            compactVoices();
+    }
+
+   /**
+      Number of voices sounding, held or releasing.
+    */
+    uint32_t getActiveVoices() const noexcept
+    {
+        uint32_t count = 0;
+        for (uint32_t v = 0; v < fNumVoices; ++v)
+            count += fVoices[v].allocated ? 1 : 0;
+        return count;
+    }
+
+   /**
+      Number of quad filter states process() runs, those with at least one sounding lane.
+    */
+    uint32_t getActiveGroups() const noexcept
+    {
+        uint32_t count = 0;
+        for (uint32_t g = 0; g < fGroups.size(); ++g)
+            count += groupSounds(g) ? 1 : 0;
+        return count;
+    }
+
+   /**
+      Bring the coefficients of every sounding voice up to date at the start of a control sub-block.@n
+      A voice's cutoff is @a freqNote moved by @a keyTrack times its distance from A4, its resonance is @a resonance
+      plus @a velocityToRes times its velocity. Like the filter slots of the effect mode, a voice keeps recomputing
+      until its smoothed target moves by less than @a tolerance, then its per-sample ramp is stopped.
+    */
+    void updateCoefficients(float freqNote, float resonance, float keyTrack, float velocityToRes, float tolerance,
+                            CoeffCache& cache)
+    {
+        for (uint32_t v = 0; v < fNumVoices; ++v)
+        {
+            Voice& voice = fVoices[v];
+            if (! voice.allocated)
+                continue;
+
+            const float note = freqNote + keyTrack * (voice.key - 69.0f);
+            const float rawRes = resonance + velocityToRes * voice.velocity;
+            const float res = rawRes < 0.0f ? 0.0f : rawRes > 1.0f ? 1.0f : rawRes;
+
+            if (note != voice.note || res != voice.res)
+            {
+                voice.note = note;
+                voice.res = res;
+                voice.coeffsSettling = true;
+                voice.coeffsNeedFreeze = false;
+            }
+
+            sst::filters::FilterCoefficientMaker<>& coeffMaker = voice.coeffMaker;
+            const uint32_t firstLane = v * NumChannels;
+
+            if (voice.coeffsSettling)
+            {
+                // every lane of the voice ramps the same way, pick up where the one of its first channel left it
+                float prevTarget[sst::filters::n_cm_coeffs];
+                for (int f = 0; f < sst::filters::n_cm_coeffs; ++f)
+                {
+                    coeffMaker.C[f] = laneState(firstLane).C[f][firstLane % 4];
+                    prevTarget[f] = coeffMaker.tC[f];
+                }
+
+                if (cache.isEnabled() && CoeffCache::covers(note))
+                {
+                    float coeffs[sst::filters::n_cm_coeffs];
+                    cache.lookup(note, res, fType, fSubType, fRate, coeffs);
+                    coeffMaker.FromDirect(coeffs);
+                }
+                else
+                {
+                    coeffMaker.MakeCoeffs(note, res, fType, fSubType, nullptr, false);
+                }
+
+                for (uint32_t lane = firstLane; lane < firstLane + NumChannels; ++lane)
+                    coeffMaker.updateState(laneState(lane), (int)(lane % 4));
+
+                bool settled = true;
+                for (int f = 0; f < sst::filters::n_cm_coeffs; ++f)
+                {
+                    if (std::fabs(coeffMaker.tC[f] - prevTarget[f]) > tolerance * (1.0f + std::fabs(coeffMaker.tC[f])))
+                    {
+                        settled = false;
+                        break;
+                    }
+                }
+
+                if (settled)
+                {
+                    voice.coeffsSettling = false;
+                    voice.coeffsNeedFreeze = true;
+                }
+            }
+            else if (voice.coeffsNeedFreeze)
+            {
+                for (uint32_t lane = firstLane; lane < firstLane + NumChannels; ++lane)
+                {
+                    sst::filters::QuadFilterUnitState& state = laneState(lane);
+                    for (int f = 0; f < sst::filters::n_cm_coeffs; ++f)
+                    {
+                        state.C[f][lane % 4] = coeffMaker.tC[f];
+                        state.dC[f][lane % 4] = 0.0f;
+                    }
+                }
+                voice.coeffsNeedFreeze = false;
+            }
+        }
+    }
+
+   /**
+      Replace each of the first NumChannels lanes of @a frames rows, @a stride floats apart, with the sum of every
+      voice filtering it. Voices that have faded out after their release are freed afterwards.@n
+      @a rows must be 16-byte aligned and @a stride a multiple of 4 of at least NumChannels.
+    */
+    void process(float* rows, uint32_t stride, uint32_t frames)
+    {
+        std::memset(fSum, 0, sizeof(float) * frames * kSumWidth);
+
+        const uint32_t numGroups = (uint32_t)fGroups.size();
+        for (uint32_t g = 0; g < numGroups; ++g)
+        {
+            if (! groupSounds(g))
+                continue;
+
+            // lane k of the state filters channel (4 g + k) % NumChannels, lanes of free voices are fed silence
+            uint32_t channels[4];
+            float gates alignas(16)[4];
+            for (uint32_t k = 0; k < 4; ++k)
+            {
+                const uint32_t lane = g * 4 + k;
+                channels[k] = lane % NumChannels;
+                gates[k] = lane < fNumVoices * NumChannels && fVoices[lane / NumChannels].allocated ? 1.0f : 0.0f;
+            }
+
+            const __m128 gate = _mm_load_ps(gates);
+            for (uint32_t i = 0; i < frames; ++i)
+            {
+                const float* const row = &rows[i * stride];
+                __m128 in;
+                if constexpr (NumChannels == 1)
+                    in = _mm_set1_ps(row[0]);
+                else if constexpr (NumChannels == 2)
+                    in = _mm_movelh_ps(_mm_load_ps(row), _mm_load_ps(row));
+                else if constexpr (NumChannels % 4 == 0)
+                    in = _mm_load_ps(&row[channels[0]]);
+                else
+                    in = _mm_setr_ps(row[channels[0]], row[channels[1]], row[channels[2]], row[channels[3]]);
+                _mm_store_ps(&fVoiceRows[i * 4], _mm_mul_ps(gate, in));
+            }
+
+            // every lane has the level of its voice, ramping up after note on and down after note off, computed from
+            // the start of the block rather than frame after frame so the frames do not wait on each other
+            const __m128 step = _mm_load_ps(&fLevelStep[g * 4]);
+            const __m128 start = _mm_load_ps(&fLevel[g * 4]);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            __m128 level = start;
+            for (uint32_t i = 0; i < frames; ++i)
+            {
+                level = _mm_add_ps(start, _mm_mul_ps(step, _mm_set1_ps((float)(i + 1))));
+                level = _mm_min_ps(_mm_max_ps(level, zero), one);
+                _mm_store_ps(&fLevelRows[i * 4], level);
+            }
+            _mm_store_ps(&fLevel[g * 4], level);
+
+            fKernel(fUnit, &fGroups[g].state, fVoiceRows, 4, frames);
+
+            // weigh every lane by its level and add it to the sum of its channel
+            for (uint32_t i = 0; i < frames; ++i)
+            {
+                const __m128 out = _mm_mul_ps(_mm_load_ps(&fVoiceRows[i * 4]), _mm_load_ps(&fLevelRows[i * 4]));
+                float* const sum = &fSum[i * kSumWidth];
+
+                if constexpr (4 % NumChannels == 0)
+                {
+                    _mm_store_ps(sum, _mm_add_ps(_mm_load_ps(sum), out));
+                }
+                else if constexpr (NumChannels % 4 == 0)
+                {
+                    _mm_store_ps(&sum[channels[0]], _mm_add_ps(_mm_load_ps(&sum[channels[0]]), out));
+                }
+                else
+                {
+                    float outs alignas(16)[4];
+                    _mm_store_ps(outs, out);
+                    for (uint32_t k = 0; k < 4; ++k)
+                        sum[channels[k]] += outs[k];
+                }
+            }
+        }
+
+        // one and two channels repeat across the four lanes of the sum, fold them together
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            const float* const sum = &fSum[i * kSumWidth];
+            float* const row = &rows[i * stride];
+
+            if constexpr (NumChannels == 1)
+            {
+                row[0] = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+            }
+            else if constexpr (NumChannels == 2)
+            {
+                row[0] = sum[0] + sum[2];
+                row[1] = sum[1] + sum[3];
+            }
+            else
+            {
+                for (uint32_t c = 0; c < NumChannels; ++c)
+                    row[c] = sum[c];
+            }
+        }
+
+        bool freed = false;
+        for (uint32_t v = 0; v < fNumVoices; ++v)
+        {
+            if (fVoices[v].allocated && ! fVoices[v].held && fLevel[v * NumChannels] <= 0.0f)
+            {
+                freeVoice(v);
+                freed = true;
+            }
+        }
+
+        if (freed)
+            compactVoices();
+    }
+
+   /**
+      Whether every register of every state in use is below @a level.
+    */
+    bool registersDecayed(float level) const
+    {
+        for (uint32_t g = 0; g < fGroups.size(); ++g)
+        {
+            if (groupSounds(g) && ! FilterKernels::registersBelow(fGroups[g].state, level))
+                return false;
+        }
+
+        return true;
+    }
+
+   /**
+      Clear the registers of every voice lane whose register energy is below @a energy.
+    */
+    void flushQuietLanes(float energy)
+    {
+        for (uint32_t g = 0; g < fGroups.size(); ++g)
+        {
+            if (groupSounds(g))
+                FilterKernels::flushQuietLanes(fGroups[g].state, energy);
+        }
+    }
+
+private:
+    // fade in after note on and fade out after note off, the filter keeps ringing underneath
+    static constexpr float kAttackMs = 2.0f;
+    static constexpr float kReleaseMs = 50.0f;
+
+    // floats per frame of the sum of the voices, the channels, or the four lanes when 1 or 2 channels repeat in them
+    static constexpr uint32_t kSumWidth = 4 % NumChannels == 0 ? 4 : (NumChannels + 3) / 4 * 4;
+
+    struct Voice {
+        uint8_t key = 0;
+        float velocity = 0.0f;
+        // allocated from note on until the release has faded out, held until note off
+        bool allocated = false;
+        bool held = false;
+        // note counter at note on, the lowest one is the oldest voice
+        uint32_t order = 0;
+
+        // cutoff note and resonance the coefficients were last computed for
+        float note = 0.0f;
+        float res = 0.0f;
+
+        sst::filters::FilterCoefficientMaker<> coeffMaker;
+        bool coeffsSettling = false;
+        bool coeffsNeedFreeze = false;
+    };
+
+    struct Group {
+        sst::filters::QuadFilterUnitState state;
+        float delayLines[4][FilterKernels::kDelayLineSize];
+    };
+
+    uint32_t fNumVoices = 0;
+    Voice fVoices[kMaxVoices];
+    uint32_t fNoteCounter = 0;
+
+    // quad states holding the lanes of every voice and channel, four at a time
+    std::vector<Group> fGroups;
+
+    sst::filters::FilterType fType = sst::filters::fut_none;
+    sst::filters::FilterSubType fSubType = sst::filters::FilterSubType(0);
+    sst::filters::FilterUnitQFPtr fUnit = nullptr;
+    FilterBlockKernel fKernel = filterBlockKernelGeneric;
+
+    float fRate = 44100.0f;
+    uint32_t fBlockSize = 1;
+    float fAttackStep = 1.0f;
+    float fReleaseStep = -1.0f;
+
+    // level of every lane and its change per frame, and the levels of one state over a block, one row per frame
+    float fLevel alignas(16)[kMaxLanes];
+    float fLevelStep alignas(16)[kMaxLanes];
+    float fLevelRows alignas(16)[MaxFrames * 4];
+
+    // the inputs and outputs of the four lanes of a state, and the sum of every voice, one row per frame
+    float fVoiceRows alignas(16)[MaxFrames * 4];
+    float fSum alignas(16)[MaxFrames * kSumWidth];
+
+    sst::filters::QuadFilterUnitState& laneState(uint32_t lane)
+    {
+        return fGroups[lane / 4].state;
+    }
+
+   /**
+      Whether a voice with a lane in state @a g is sounding.
+    */
+    bool groupSounds(uint32_t g) const noexcept
+    {
+        const uint32_t lastLane = g * 4 + 3 < fNumVoices * NumChannels ? g * 4 + 3 : fNumVoices * NumChannels - 1;
+        for (uint32_t v = g * 4 / NumChannels; v <= lastLane / NumChannels; ++v)
+        {
+            if (fVoices[v].allocated)
+                return true;
+        }
+        return false;
+    }
+
+   /**
+      Clear every filter state, only the lanes of sounding voices stay active.
+    */
+    void resetGroups()
+    {
+        for (Group& g : fGroups)
+            FilterKernels::resetState(g.state, g.delayLines, 0);
+
+        for (uint32_t v = 0; v < fNumVoices; ++v)
+        {
+            for (uint32_t lane = v * NumChannels; lane < (v + 1) * NumChannels && fVoices[v].allocated; ++lane)
+                laneState(lane).active[lane % 4] = 0xFFFFFFFF;
+        }
+    }
+
+    void setLevelStep(uint32_t v, float step)
+    {
+        for (uint32_t lane = v * NumChannels; lane < (v + 1) * NumChannels; ++lane)
+            fLevelStep[lane] = step;
+    }
+
+    void freeVoice(uint32_t v)
+    {
+        fVoices[v].allocated = false;
+        fVoices[v].held = false;
+
+        for (uint32_t lane = v * NumChannels; lane < (v + 1) * NumChannels; ++lane)
+        {
+            fLevel[lane] = 0.0f;
+            fLevelStep[lane] = 0.0f;
+
+            sst::filters::QuadFilterUnitState& state = laneState(lane);
+            FilterKernels::resetLane(state, lane % 4);
+            state.active[lane % 4] = 0;
+        }
+    }
+
+   /**
+      Move the highest sounding voices down into the lowest free ones, lanes and all, until no gap is left below them.
+    */
+    void compactVoices()
+    {
+        for (;;)
+        {
+            const uint32_t to = findFreeVoice();
+
+            uint32_t from = fNumVoices;
+            while (from > 0 && ! fVoices[from - 1].allocated)
+                --from;
+
+            if (to == kMaxVoices || from == 0 || to >= from - 1)
+                return;
+            --from;
+
+            for (uint32_t c = 0; c < NumChannels; ++c)
+            {
+                const uint32_t fromLane = from * NumChannels + c;
+                const uint32_t toLane = to * NumChannels + c;
+                FilterKernels::moveLane(laneState(fromLane), fromLane % 4, laneState(toLane), toLane % 4);
+                fLevel[toLane] = fLevel[fromLane];
+                fLevelStep[toLane] = fLevelStep[fromLane];
+                fLevel[fromLane] = 0.0f;
+                fLevelStep[fromLane] = 0.0f;
+            }
+
+            fVoices[to] = fVoices[from];
+            fVoices[from].allocated = false;
+            fVoices[from].held = false;
+        }
+    }
+
+   /**
+      Voice already playing @a key, or kMaxVoices.
+    */
+    uint32_t findVoice(uint8_t key) const noexcept
+    {
+        for (uint32_t v = 0; v < fNumVoices; ++v)
+        {
+            if (fVoices[v].allocated && fVoices[v].key == key)
+                return v;
+        }
+        return kMaxVoices;
+    }
+
+   /**
+      Lowest free voice, so sounding voices stay packed in as few states as possible, or kMaxVoices.
+    */
+    uint32_t findFreeVoice() const noexcept
+    {
+        for (uint32_t v = 0; v < fNumVoices; ++v)
+        {
+            if (! fVoices[v].allocated)
+                return v;
+        }
+        return kMaxVoices;
+    }
+
+   /**
+      The quietest released voice, or the oldest held one if every voice is held.
+    */
+    uint32_t findVoiceToSteal() const noexcept
+    {
+        uint32_t quietest = kMaxVoices;
+        uint32_t oldest = 0;
+
+        for (uint32_t v = 0; v < fNumVoices; ++v)
+        {
+            const float level = fLevel[v * NumChannels];
+            if (! fVoices[v].held && (quietest == kMaxVoices || level < fLevel[quietest * NumChannels]))
+                quietest = v;
+            if (fVoices[v].order < fVoices[oldest].order)
+                oldest = v;
+        }
+
+        return quietest != kMaxVoices ? quietest : oldest;
+    }
+};
+
+#endif  // #ifndef VOICE_BANK_H
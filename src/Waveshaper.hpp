@@ -0,0 +1,267 @@
+/**
+ * Drive stage for frame-major rows, saturating or folding every lane of the work buffer.
+ *
+ * Every shape is a table of its curve, interpolated linearly, along with the exact antiderivative of the interpolated
+ * curve. The output is the mean of the curve between the previous and the current input, which is first order
+ * antiderivative anti-aliasing: hard drive aliases far less than sampling the curve directly, without having to
+ * oversample, at the cost of half a sample of delay.
+ * The rows hold Lanes floats per frame, the same layout as the plugin work buffer, four lanes at a time in the same
+ * SSE registers the quad filter states use.
+ */
+
+#ifndef WAVESHAPER_H
+#define WAVESHAPER_H
+
+#include "SimdSetup.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+template <uint32_t Lanes>
+class Waveshaper
+{
+public:
+    static_assert(Lanes % 4 == 0, "Waveshaper rows must hold a multiple of 4 lanes");
+
+    enum Shape {
+        kShapeOff = 0,
+        kShapeSoftClip,
+        kShapeTanh,
+        kShapeAsymmetric,
+        kShapeFold,
+        kShapeCount
+    };
+
+    Waveshaper()
+    {
+        reset();
+    }
+
+   /**
+      Select one of Shape, a new shape starts from a clear state.
+    */
+    void setShape(int shape) noexcept
+    {
+        shape = shape < 0 ? 0 : shape >= kShapeCount ? kShapeCount - 1 : shape;
+        if (shape == fShape)
+            return;
+
+        fShape = shape;
+        reset();
+    }
+
+    int getShape() const noexcept
+    {
+        return fShape;
+    }
+
+   /**
+      Forget the previous input, every curve has its antiderivative at 0 for an input of 0.
+    */
+    void reset() noexcept
+    {
+        std::memset(fPrevInput, 0, sizeof(fPrevInput));
+        std::memset(fPrevIntegral, 0, sizeof(fPrevIntegral));
+    }
+
+   /**
+      Shape @a frames rows of @a rows in place, every row multiplied by its own gain from @a drive first.
+      Does nothing for kShapeOff. @a rows must be 16-byte aligned.
+    */
+    void process(float* rows, const float* drive, uint32_t frames) noexcept
+    {
+        if (fShape == kShapeOff)
+            return;
+
+        const Table& table = getTable(fShape);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 minStep = _mm_set1_ps(kMinStep);
+
+        for (uint32_t i = 0; i < frames; ++i, rows += Lanes)
+        {
+            const __m128 gain = _mm_set1_ps(drive[i]);
+
+            for (uint32_t l = 0; l < Lanes; l += 4)
+            {
+                const __m128 x = _mm_mul_ps(_mm_load_ps(&rows[l]), gain);
+                const __m128 prev = _mm_load_ps(&fPrevInput[l]);
+
+                __m128 curve, integral;
+                evaluate(table, x, curve, integral);
+
+                // the difference of the antiderivatives loses too many bits over a short step, the curve at the
+                // middle of the step is its mean there to within the table accuracy
+                const __m128 step = _mm_sub_ps(x, prev);
+                const __m128 size = _mm_add_ps(_mm_max_ps(x, _mm_sub_ps(zero, x)),
+                                               _mm_max_ps(prev, _mm_sub_ps(zero, prev)));
+                const __m128 shortStep = _mm_cmplt_ps(_mm_max_ps(step, _mm_sub_ps(zero, step)),
+                                                      _mm_mul_ps(_mm_add_ps(size, one), minStep));
+
+                const __m128 safeStep = _mm_or_ps(_mm_and_ps(shortStep, one), _mm_andnot_ps(shortStep, step));
+                __m128 y = _mm_div_ps(_mm_sub_ps(integral, _mm_load_ps(&fPrevIntegral[l])), safeStep);
+
+                if (_mm_movemask_ps(shortStep) != 0)
+                {
+                    __m128 middle, unused;
+                    evaluate(table, _mm_mul_ps(_mm_add_ps(x, prev), half), middle, unused);
+                    y = _mm_or_ps(_mm_and_ps(shortStep, middle), _mm_andnot_ps(shortStep, y));
+                }
+
+                _mm_store_ps(&rows[l], y);
+                _mm_store_ps(&fPrevInput[l], x);
+                _mm_store_ps(&fPrevIntegral[l], integral);
+            }
+        }
+    }
+
+private:
+    // table intervals of every shape, over [-8, 8] for the saturating ones and over one period for the fold
+    static constexpr uint32_t kIntervals = 1024;
+
+    // steps shorter than this, relative to the size of the input, fall back to the curve at their middle
+    static constexpr float kMinStep = 1e-3f;
+
+   /**
+      One table interval: the curve at its start, how much it rises across, and the antiderivative at its start.
+    */
+    struct Point {
+        float curve;
+        float rise;
+        float integral;
+        float unused;
+    };
+
+    struct Table {
+        float low;
+        float interval;
+        float invInterval;
+        // the fold repeats every period, the saturating curves stay flat beyond the table
+        bool periodic;
+        float period;
+        Point points[kIntervals];
+    };
+
+    struct Tables {
+        Table shapes[kShapeCount];
+
+        Tables()
+        {
+            for (int shape = kShapeSoftClip; shape < kShapeCount; ++shape)
+                build(shapes[shape], shape);
+        }
+    };
+
+    static const Table& getTable(int shape) noexcept
+    {
+        static const Tables tables;
+        return tables.shapes[shape];
+    }
+
+   /**
+      The curve of @a shape at @a x, at unity drive.
+    */
+    static double curveAt(int shape, double x)
+    {
+        switch (shape) {
+        case kShapeSoftClip:
+            // x - 4/27 x^3 up to +-1.5, flat at +-1 beyond
+            return std::fabs(x) >= 1.5 ? std::copysign(1.0, x) : x - 4.0 / 27.0 * x * x * x;
+        case kShapeTanh:
+            return std::tanh(x);
+        case kShapeAsymmetric:
+            // tanh pushed off centre, clipping the negative half harder and adding even harmonics
+            return std::tanh(x + 0.5) - std::tanh(0.5);
+        case kShapeFold:
+            // triangle, rising through 0 and folding back at +-1, over one period from -2 to 2
+            return std::fabs(x) <= 1.0 ? x : std::copysign(2.0, x) - x;
+        default:
+            return x;
+        }
+    }
+
+    static void build(Table& table, int shape)
+    {
+        table.periodic = shape == kShapeFold;
+        table.period = 4.0f;
+        table.low = table.periodic ? -2.0f : -8.0f;
+        table.interval = -2.0f * table.low / kIntervals;
+        table.invInterval = 1.0f / table.interval;
+
+        // the antiderivative of the interpolated curve, accumulated in double and rounded only once it is 0 at 0,
+        // so that small inputs get it to full precision
+        double atZero = 0.0;
+        for (uint32_t j = 0; j < kIntervals / 2; ++j)
+            atZero += 0.5 * (curveAt(shape, table.low + (double)table.interval * j)
+                             + curveAt(shape, table.low + (double)table.interval * (j + 1))) * table.interval;
+
+        double integral = -atZero;
+        for (uint32_t j = 0; j < kIntervals; ++j)
+        {
+            const double start = curveAt(shape, table.low + (double)table.interval * j);
+            const double end = curveAt(shape, table.low + (double)table.interval * (j + 1));
+
+            Point& point = table.points[j];
+            point.curve = (float)start;
+            point.rise = (float)(end - start);
+            point.integral = (float)integral;
+            point.unused = 0.0f;
+
+            integral += 0.5 * (start + end) * table.interval;
+        }
+    }
+
+   /**
+      The interpolated curve and its antiderivative of @a table for the four lanes of @a x.
+    */
+    static void evaluate(const Table& table, __m128 x, __m128& curve, __m128& integral) noexcept
+    {
+        float in alignas(16)[4];
+        float pos alignas(16)[4];
+        float folded alignas(16)[4];
+        __m128 p[4];
+
+        _mm_store_ps(in, x);
+
+        for (uint32_t k = 0; k < 4; ++k)
+        {
+            float u = in[k];
+            if (table.periodic)
+                u -= table.period * std::floor((u - table.low) / table.period);
+            else
+                u = u < table.low ? table.low : u > -table.low ? -table.low : u;
+
+            const float position = (u - table.low) * table.invInterval;
+            uint32_t j = position > 0.0f ? (uint32_t)position : 0;
+            j = j < kIntervals ? j : kIntervals - 1;
+
+            // the interval is a power of two, so its start is exact and u keeps all its bits for the fraction
+            p[k] = _mm_loadu_ps(&table.points[j].curve);
+            pos[k] = (u - (table.low + table.interval * j)) * table.invInterval;
+            folded[k] = u;
+        }
+
+        _MM_TRANSPOSE4_PS(p[0], p[1], p[2], p[3]);
+
+        const __m128 t = _mm_load_ps(pos);
+        curve = _mm_add_ps(p[0], _mm_mul_ps(p[1], t));
+
+        // start + h t (curve + rise t / 2), the exact integral of the line across the part of the interval covered
+        const __m128 area = _mm_add_ps(p[0], _mm_mul_ps(_mm_mul_ps(p[1], t), _mm_set1_ps(0.5f)));
+        integral = _mm_add_ps(p[2], _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(table.interval), t), area));
+
+        // beyond the table a saturating curve stays flat, so its antiderivative goes on as a straight line
+        if (! table.periodic)
+            integral = _mm_add_ps(integral, _mm_mul_ps(curve, _mm_sub_ps(x, _mm_load_ps(folded))));
+    }
+
+    int fShape = kShapeOff;
+
+    // input after the drive gain and its antiderivative, of the last row
+    float fPrevInput alignas(16)[Lanes];
+    float fPrevIntegral alignas(16)[Lanes];
+};
+
+#endif  // #ifndef WAVESHAPER_H